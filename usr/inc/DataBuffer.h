@@ -3,9 +3,16 @@
 
 #include "lcd.h"
 
+#define __SECTION_AXIRAM __attribute__((section(".RAM_AXI"))) /* AXI SRAM (D1 domain): */
+
+#define __SECTION_RAM_D2 __attribute__((section(".RAM_D2"))) /* AHB SRAM (D2 domain): */
+
+#define __SECTION_RAM_D3 __attribute__((section(".RAM_D3"))) /* AHB SRAM (D3 domain): */
+
 #define BUF_SIZE 2048
 extern u8 samplesBuffer[BUF_SIZE];
 
 extern u8 firstHalf; // first or second half of buffer writing
+extern volatile u32 acqCount; // number of filled halves since start
 
 #endif //_DATABUFFER_H
@@ -1,7 +1,15 @@
 #ifndef F7_FMC_ADC_H
 #define F7_FMC_ADC_H
 
+#include "_main.h"
+
+#define ADC_VREF_MV  3300  // ADC full scale, mV
+
+extern u8 adcDual;
+extern float ADC_SampleUs;
+
 void ADC_setParams();
+void ADC_setXY(u8 on);
 void ADC_step(int16_t step);
 
 #endif //F7_FMC_ADC_H
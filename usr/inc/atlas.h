@@ -0,0 +1,22 @@
+#ifndef __ATLAS_H
+#define __ATLAS_H
+
+#include "_main.h"
+#include "font.h"
+
+// 12 pixel font, RGB565 glyphs for a few color pairs
+#define ATLAS_W      FONT_1206_W
+#define ATLAS_H      FONT_1206_H
+#define ATLAS_SLOTS  4
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+const u16 *ATLAS_glyph(u8 ch, u16 color, u16 back);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ATLAS_H */
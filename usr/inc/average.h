@@ -0,0 +1,33 @@
+#ifndef __AVERAGE_H
+#define __AVERAGE_H
+
+#include "_main.h"
+#include "DataBuffer.h"
+
+// averaged record - samples from trigger position
+#define AVG_SIZE   (BUF_SIZE / 4)
+// acquisition time per displayed frame, microseconds
+#define AVG_ACQ_US 30000
+
+// averaging types
+#define AVG_BLOCK  0  // sum of 2^avgShift frames, then restart
+#define AVG_EXP    1  // exponential, weight of new frame 1/2^avgShift
+
+extern u8 avgMode;
+extern u8 avgShift;  // log2 of averages number, 2..8
+extern u32 avgDone;  // result updates since reset
+extern u8 avgBuffer[AVG_SIZE];
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void AVG_reset();
+void AVG_add(u8 const *samples);
+void AVG_acquire();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __AVERAGE_H */
@@ -0,0 +1,36 @@
+#ifndef __DMA2D_H
+#define __DMA2D_H
+
+#include "_main.h"
+
+// smaller areas are faster by CPU than DMA2D setup
+#define D2D_MIN_PIXELS  64
+
+// alpha source formats, FGPFCCR.CM
+#define D2D_A8  9
+#define D2D_A4  10
+
+extern u8 lcdD2D;  // lcd.c frame buffer drawing through DMA2D
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void D2D_init();
+void D2D_wait();
+void D2D_fill(u16 *dst, u16 w, u16 h, u16 color);
+void D2D_copy(u16 const *src, u16 srcPitch, u16 *dst, u16 w, u16 h);
+void D2D_blend(u16 const *src, u16 srcPitch, u16 *dst, u16 w, u16 h, u8 alpha);
+void D2D_convertL8(u8 const *src, u16 srcPitch, u32 const *clut, u16 clutSize, u16 *dst, u16 w, u16 h);
+void D2D_pushL8(u8 const *src, u32 const *clut, u16 *lcdRam);
+void D2D_alpha(u8 const *src, u8 format, u16 srcPitch, u16 color, u16 *dst, u16 w, u16 h);
+void D2D_loadCluts(u32 const *bgClut, u32 const *fgClut);
+void D2D_composeTile(u16 *dst, u8 const *grid, u8 const *trace, u8 const *overlay, u16 color, u16 w, u16 h);
+void D2D_char(u16 x, u16 y, u8 ch, u16 color, u16 back, u8 mode);
+void D2D_benchmark();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DMA2D_H */
@@ -1,6 +1,26 @@
 #ifndef F7_FMC_DRAW_H
 #define F7_FMC_DRAW_H
 
+#include "_main.h"
+
+// display modes
+#define DRAW_YT       0  // one trace per frame
+#define DRAW_PERSIST  1  // intensity graded persistence
+#define DRAW_ENVELOPE 2  // min/max band of all traces since reset
+#define DRAW_XY       3  // channel 2 versus channel 1
+#define DRAW_ZOOM     4  // whole record and zoom window
+#define DRAW_FFT      5  // spectrum
+#define DRAW_WATERFALL 6 // spectrum history, hardware scrolled
+#define DRAW_DIRTY    7  // one trace per frame, only changed pixels sent
+#define DRAW_FADE     8  // traces fade out by palette of L8 frame buffer
+#define DRAW_LAYERS   9  // grid, trace and readout layers, changed tiles composed
+
+extern u8 drawMode;
+extern u8 drawFB;  // 0 - LCD, FB_RGB565, FB_L8
+extern u16 gridX[];  // grid line color of column, 0 - none
+extern u16 gridY[];  // grid line color of row, background if none
+
+void gridInit();
 void drawFrame();
 void drawScreen();
 
@@ -0,0 +1,44 @@
+#ifndef __EVENTS_H
+#define __EVENTS_H
+
+#include "_main.h"
+
+// event types
+#define EV_RISE   0  // low to high transition
+#define EV_FALL   1  // high to low transition
+#define EV_WIDTH  2  // high pulse shorter than evMinWidth or longer than evMaxWidth
+#define EV_RUNT   3  // left one level and came back without reaching the other
+
+// event table size
+#define EV_MAX    256
+
+struct EV_event {
+    u16 pos;    // sample in record where transition starts
+    u16 width;  // samples: transition time, pulse width or runt length
+    u8 type;
+};
+typedef struct EV_event EV_EVENT;
+
+extern u8 evLow;        // low level, ADC code
+extern u8 evHigh;       // high level, ADC code
+extern u16 evMinWidth;  // pulse width limits, samples
+extern u16 evMaxWidth;
+extern EV_EVENT evTable[];
+extern u16 evCount;
+extern u8 evOverflow;   // more events than EV_MAX in record
+extern s16 evCurrent;   // selected event, -1 - none
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int EV_search(u8 const *rec, u32 len);
+int EV_next();
+int EV_prev();
+void EV_export();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __EVENTS_H */
@@ -0,0 +1,21 @@
+#ifndef __FADE_H
+#define __FADE_H
+
+#include "_main.h"
+#include "framebuf.h"
+
+// frames a trace stays visible, palette indexes above lcd.c colors
+#define FADE_AGES  (256 - FB8_COLORS)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void FADE_start();
+void drawFade();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FADE_H */
@@ -0,0 +1,38 @@
+#ifndef __FFT_H
+#define __FFT_H
+
+#include "_main.h"
+
+// largest transform, points
+#define FFT_MAX_BITS  12
+#define FFT_MAX       (1 << FFT_MAX_BITS)
+#define FFT_MIN       256
+
+// windows
+#define FFT_RECT      0
+#define FFT_HANN      1
+#define FFT_FLATTOP   2
+#define FFT_BLACKMAN  3  // 4 term Blackman-Harris
+
+// screen range, dB below full scale sine
+#define FFT_RANGE_DB  100
+#define FFT_PEAKS     3
+
+extern u16 fftSize;
+extern u8 fftWindow;
+extern float fftDb[];  // bins 0..fftSize/2-1, dB of full scale
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void FFT_init();
+void FFT_setup(u16 size, u8 window);
+void FFT_run(u8 const *rec, u32 len);
+void drawSpectrum();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FFT_H */
@@ -0,0 +1,51 @@
+#ifndef __FRAMEBUF_H
+#define __FRAMEBUF_H
+
+#include "_main.h"
+#include "lcd.h"
+
+#define FB_PIXELS  (MAX_X * MAX_Y)
+
+// frame buffer formats, drawFB
+#define FB_RGB565  1
+#define FB_L8      2  // palette index, DMA2D expands it to RGB565 on the way to LCD
+
+// L8 indexes below are given to lcd.c colors on first use, above - set by owner
+#define FB8_COLORS 192
+
+extern u16 *lcdFB;  // drawing target of lcd.c, NULL - LCD itself
+extern u8 *lcdFB8;  // L8 drawing target of lcd.c
+extern u8 fbKeep;   // draw next frame over the last one, L8 only
+extern u32 fb8Clut[];    // palette of L8 index
+extern u16 fb8Colors[];  // lcd.c color of index below FB8_COLORS
+extern u16 fb8LastColor;
+extern u8 fb8LastIndex;
+extern uint32_t FBPushStart;
+extern uint32_t FBPushEnd;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void FB_init();
+void FB_begin(u8 l8);
+void FB_flush();
+void FB_pushRows(u16 y0, u16 rows);
+void FB_end();
+void FB_wait();
+u8 FB8_alloc(u16 color);
+void FB8_setColor(u8 index, u16 color);
+
+/**
+ * Palette index of lcd.c color, same color runs are usual
+ */
+static inline u8 FB8_index(u16 color) {
+    if (color == fb8LastColor) return fb8LastIndex;
+    return FB8_alloc(color);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FRAMEBUF_H */
@@ -5,14 +5,52 @@
 #include "lcd.h"
 
 
+// graph building modes
+#define GRAPH_MEAN  0  // arithmetical mean of column samples
+#define GRAPH_PEAK  1  // min and max of column samples (peak detect)
+
+// acquisition modes
+#define ACQ_NORMAL  0  // last triggered frame
+#define ACQ_AVERAGE 1  // average of triggered frames
+
+// envelope acquisition time per displayed frame, microseconds
+#define ENV_ACQ_US  30000
+
 extern float scaleX;
+// graph columns are screen Y, after vertical scale table
 extern uint8_t graph[];
+extern uint8_t graphMin[];
+extern uint8_t graphMax[];
+extern u8 graphMode;
+extern u8 graphInterp;
+extern u8 acqMode;
+extern uint8_t envMin[];
+extern uint8_t envMax[];
+extern u32 envCount;
+extern u32 dirtyPixels;
+extern const u16 voltsDiv[];
+extern u8 vScale;
+extern s16 vOffset;
+extern u8 vlut[];   // ADC code -> screen Y
+extern u16 hlut[];  // ADC code -> screen X, XY mode
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+void graphSetVertical(u8 scale, s16 offset);
+int triggerStart1ch(u8 const *samples);
+int buildGraphStep(u8 const *samples, int start, int len, u32 step);
+void buildGraph(u8 const *samples, int start, int len);
+void buildGraph1ch();
+int nextAcquisition(u32 *seq);
+void drawSpans(u8 const *mn, u8 const *mx, u16 cols, u16 color);
 void drawGraph();
+void graphDirtyReset();
+void drawGraphDirty();
+void envelopeReset();
+void envelopeAdd();
+void drawEnvelope();
 
 #ifdef __cplusplus
 }
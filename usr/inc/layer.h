@@ -0,0 +1,41 @@
+#ifndef __LAYER_H
+#define __LAYER_H
+
+#include "_main.h"
+
+// composition tiles
+#define LAYER_TILE_W  32
+#define LAYER_TILE_H  16
+#define LAYER_TILES_X (MAX_X / LAYER_TILE_W)
+#define LAYER_TILES_Y (MAX_Y / LAYER_TILE_H)
+
+// transparent overlay index, above lcd.c colors
+#define LAYER_CLEAR   255
+#define LAYER_TRACE_COLOR BLUE
+
+// band timeline of one frame, ticks from frame start, dmaStart == dmaEnd - band not sent
+typedef struct {
+    u32 cpuStart, cpuEnd;  // band composition
+    u32 dmaStart, dmaEnd;  // band push to LCD
+} LAYER_BAND_TIME;
+
+extern u8 layerBands;   // compose band, push it by MDMA while next band is composed; set before LAYER_start
+extern u32 layerTiles;  // tiles composed in last frame
+extern LAYER_BAND_TIME layerTimeline[];
+extern u32 LayerCpuTick, LayerDmaTick, LayerFrameTick;  // busy times and length of last banded frame
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void LAYER_init();
+void LAYER_start();
+void LAYER_stop();
+void LAYER_compose();
+void drawLayers();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LAYER_H */
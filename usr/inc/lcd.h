@@ -65,6 +65,27 @@ extern u16 BACK_COLOR;  // Background color
 #define LIGHTGREEN   0X841F
 #define LIGHTGRAY    0XEF5B
 
+// digits of number readout, 32 bit value
+#define LCD_READOUT_LEN 10
+
+// number readout with digits on screen, {x, y, len, size} set by user
+typedef struct {
+    u16 x, y;
+    u8 len, size;
+    char shown[LCD_READOUT_LEN];
+    u32 generation;      // lcdGeneration when shown
+    const void *target;  // frame buffer when shown
+    u16 color, back;
+    u8 listed;           // in list checked by LCD_Damage
+} LCD_Readout;
+
+// readouts checked for damage by drawing on kept screen
+#define LCD_READOUTS_MAX 8
+
+extern u8 lcdPacked;       // LCD data as 32 bit stores
+extern u32 lcdGeneration;  // incremented when whole screen is redrawn
+extern u16 lcdReadoutTop;  // first row of any readout
+
 
 #ifdef __cplusplus
 extern "C" {
@@ -74,6 +95,7 @@ void LCD_Init(void);                                                        // I
 void LCD_Clear(u16 Color);                                                    // Clear the screen
 void LCD_SetCursor(u16 Xpos, u16 Ypos);                                        // Set the cursor
 void LCD_DrawPoint(u16 x, u16 y);                                            // Draw the points
+u16 LCD_ReadPoint(u16 x, u16 y);                                                // Read the point
 void LCD_Fast_DrawPoint(u16 x, u16 y, u16 color);                                // Quickly draw points
 void LCD_Draw_Circle(u16 x0, u16 y0, u8 r);                                        // Draw a circle
 void LCD_DrawLine(u16 x1, u16 y1, u16 x2, u16 y2);                            // Draw lines
@@ -83,10 +105,15 @@ void LCD_drawBMP(u16 sx, u16 sy, u16 ex, u16 ey, const u16 *bmp);
 void LCD_ShowChar(u16 x, u16 y, u8 num, u8 size, u8 mode);                        // display a character
 void LCD_ShowNum(u16 x, u16 y, u32 num, u8 len, u8 size);                        // display a number
 void LCD_ShowxNum(u16 x, u16 y, u32 num, u8 len, u8 size, u8 mode);                // display numbers
+void LCD_ShowReadout(LCD_Readout *r, u32 num, u8 mode);                            // display number, changed digits only
+void LCD_Damage(u16 x0, u16 y0, u16 x1, u16 y1);    // area drawn over without screen clear, readouts in it redrawn
 void LCD_ShowString(u16 x, u16 y, u16 width, u16 height, u8 size, const char *p, u8 mode);    // display a string,12/16 font
 void LCD_Scan_Dir(u8 dir);                           // Set the screen scan direction
 void LCD_Display_Dir(u8 dir);                        // set the screen display direction
+void LCD_Init_sequence();                            // ILI9341 registers setup
 void LCD_Set_Window(u16 sx, u16 sy, u16 ex, u16 ey); // Set the window
+void LCD_Scroll_Area(u16 top, u16 height, u16 bottom); // Vertical scrolling definition
+void LCD_Scroll(u16 line);                           // Vertical scrolling start address
 
 #ifdef __cplusplus
 }
@@ -40,6 +40,33 @@ __STATIC_INLINE void LCD_WR_DATA(vu16 data) {
     LCD->LCD_RAM = data;
 }
 
+// LCD data address as 32 bit: FMC splits word store into two 16 bit data cycles, low half first
+#define LCD_RAM32 (*(volatile u32 *) &LCD->LCD_RAM)
+
+// n pixels of one color, pixel pair per store
+__STATIC_INLINE void LCD_WR_DATA_N(u16 color, u32 n) {
+    u32 c = color | (u32) color << 16;
+    for (; n >= 8; n -= 8) {
+        LCD_RAM32 = c;
+        LCD_RAM32 = c;
+        LCD_RAM32 = c;
+        LCD_RAM32 = c;
+    }
+    for (; n >= 2; n -= 2) LCD_RAM32 = c;
+    if (n) LCD->LCD_RAM = color;
+}
+
+// n pixels from memory, pixel pair per store
+__STATIC_INLINE void LCD_WR_DATA_BUF(const u16 *p, u32 n) {
+    if (((u32) p & 2) && n) {
+        LCD->LCD_RAM = *p++;
+        n--;
+    }
+    const u32 *w = (const u32 *) p;
+    for (; n >= 2; n -= 2) LCD_RAM32 = *w++;
+    if (n) LCD->LCD_RAM = *(const u16 *) w;
+}
+
 // Read LCD data
 // Return Value: Value read
 __STATIC_INLINE u16 LCD_RD_DATA(void) {
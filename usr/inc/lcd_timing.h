@@ -0,0 +1,22 @@
+#ifndef __LCD_TIMING_H
+#define __LCD_TIMING_H
+
+#include "_main.h"
+
+// GRAM row written and read back by the test
+#define LCD_TUNE_ROW  0
+
+extern u32 lcdWriteMBs10;  // LCD write throughput after tuning, 0.1 MB/s
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void LCD_TuneTiming();
+void LCD_BenchWrite();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LCD_TIMING_H */
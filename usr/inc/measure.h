@@ -0,0 +1,35 @@
+#ifndef __MEASURE_H
+#define __MEASURE_H
+
+#include "_main.h"
+
+// minimal swing for time measurements, ADC codes
+#define MEAS_MIN_SWING  8
+// status rows on top of screen
+#define MEAS_Y          0
+
+struct MEAS_values {
+    u16 vpp, vmin, vmax, mean, rms;  // mV
+    u32 freq;                        // Hz, 0 - no periods in record
+    u32 period;                      // ns
+    u8 duty;                         // %
+    u32 rise, fall;                  // 10-90% time, ns
+    u8 overshoot;                    // % of top-base amplitude
+};
+typedef struct MEAS_values MEAS_VALUES;
+
+extern MEAS_VALUES meas;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void MEAS_run(u8 const *p, u32 len);
+void MEAS_update();
+void MEAS_draw();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MEASURE_H */
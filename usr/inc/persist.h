@@ -0,0 +1,32 @@
+#ifndef __PERSIST_H
+#define __PERSIST_H
+
+#include "_main.h"
+
+// hit-count histogram rows - full range of graph values
+#define PERSIST_ROWS  256
+// histogram increment per waveform. Dozens of waves per frame - must stay small to keep grading
+#define PERSIST_HIT   1
+// acquisition time per displayed frame, microseconds
+#define PERSIST_ACQ_US 30000
+
+extern u8 persistDecay;  // proportional decay per frame: count >> persistDecay
+extern u32 persistWaves; // waveforms added in last frame
+extern u16 persistPalette[]; // black - blue - cyan - yellow - white
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void PERSIST_init();
+void PERSIST_clear();
+void PERSIST_add();
+void PERSIST_decay();
+void PERSIST_draw();
+void drawPersist();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PERSIST_H */
@@ -0,0 +1,34 @@
+#ifndef __PYRAMID_H
+#define __PYRAMID_H
+
+#include "_main.h"
+#include "DataBuffer.h"
+
+// record of pyramid - half of samples buffer
+#define PYR_RECORD     (BUF_SIZE / 2)
+// samples in leaf node. Leaf min + max is 2 bytes per 16 samples, all levels - 1/4 of record
+#define PYR_LEAF_BITS  4
+#define PYR_LEAF       (1 << PYR_LEAF_BITS)
+#define PYR_LEAVES     (PYR_RECORD / PYR_LEAF)
+#define PYR_NODES      (2 * PYR_LEAVES - 1)
+
+typedef struct {
+    u8 min[PYR_NODES];
+    u8 max[PYR_NODES];
+} PYR_INDEX;
+
+extern PYR_INDEX pyrHalf[2];  // of samples buffer halves, last filled
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void PYR_update(u32 half);
+void PYR_minMax(PYR_INDEX const *pyr, u8 const *rec, u32 a, u32 b, u8 *pMin, u8 *pMax);
+int PYR_buildGraph(PYR_INDEX const *pyr, u8 const *rec, u32 first, u32 count, u32 step);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PYRAMID_H */
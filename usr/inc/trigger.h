@@ -0,0 +1,30 @@
+#ifndef __TRIGGER_H
+#define __TRIGGER_H
+
+#include "_main.h"
+
+// trigger sources
+#define TRG_SOFTWARE    0  // CPU scans samples for level crossing
+#define TRG_COMPARATOR  1  // COMP1 crossing captured by TIM2 CH4, DMA latches ADC DMA position
+
+// number of latched trigger positions kept by DMA (ring)
+#define TRG_LATCH_SIZE  32
+
+extern u8 trgMode;
+extern u8 trgLevel;
+extern u8 trgHysteresis;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void TRG_init();
+void TRG_setLevel(u8 level);
+void TRG_setHysteresis(u8 hyst);
+int TRG_findLatched(u32 start, u32 len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TRIGGER_H */
@@ -0,0 +1,25 @@
+#ifndef __WATERFALL_H
+#define __WATERFALL_H
+
+#include "_main.h"
+
+// FFT points per row, half of them are shown
+#define WF_FFT     512
+// acquisition time per displayed frame, microseconds
+#define WF_ACQ_US  30000
+
+extern u32 wfRows;  // rows added in last frame
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void WF_start();
+void WF_stop();
+void drawWaterfall();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __WATERFALL_H */
@@ -0,0 +1,24 @@
+#ifndef __XY_H
+#define __XY_H
+
+#include "_main.h"
+
+// acquisition time per displayed frame, microseconds
+#define XY_ACQ_US   30000
+#define XY_COLOR    YELLOW
+
+extern u32 xyPoints;  // points plotted in last frame
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void XY_start();
+void XY_stop();
+void drawXY();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __XY_H */
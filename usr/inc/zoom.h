@@ -0,0 +1,31 @@
+#ifndef __ZOOM_H
+#define __ZOOM_H
+
+#include "_main.h"
+#include "lcd.h"
+#include "DataBuffer.h"
+
+// record shown in overview pane - one half of samples buffer
+#define ZOOM_RECORD  (BUF_SIZE / 2)
+// first row of zoom pane, overview pane is above
+#define ZOOM_SPLIT   (MAX_Y / 2)
+
+extern u16 zoomPos;  // first sample of zoom window in record
+extern u16 zoomLen;  // samples in zoom window
+extern u8 zoomHold;  // keep current record
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void zoomSetWindow(int pos, int len);
+void zoomSelect(u8 action);
+void zoomControl(int step);
+void zoomStepEvent(int dir);
+void drawZoom();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ZOOM_H */
@@ -6,6 +6,15 @@
 #include <DataBuffer.h>
 #include <generator.h>
 #include <adc.h>
+#include <trigger.h>
+#include <persist.h>
+#include <graph.h>
+#include <measure.h>
+#include <fft.h>
+#include <framebuf.h>
+#include <dma2d.h>
+#include <layer.h>
+#include <lcd_timing.h>
 
 
 void CORECheck();
@@ -19,9 +28,20 @@ extern float time;
 void mainInitialize() {
     DWT_Init();
     LCD_Init();
+    LCD_TuneTiming();
+    LCD_BenchWrite();
 
     HAL_ADC_Start_DMA(&hadc1, (uint32_t *) samplesBuffer, BUF_SIZE);
     //ADC_setParams();
+    TRG_init();
+    PERSIST_init();
+    graphSetVertical(vScale, vOffset);
+    envelopeReset();
+    FFT_init();
+    FB_init();
+    D2D_init();
+    gridInit();
+    LAYER_init();
 
     HAL_TIM_PWM_Start(&htim1, TIM_CHANNEL_1);
     //GEN_setParams();
@@ -32,10 +52,19 @@ void mainInitialize() {
 
     CORECheck();
     FPUCheck();
+    D2D_benchmark();
 }
 
+// mainCycle debug values, redrawn on change only
+static LCD_Readout readouts[5] = {{0, 214, 5, 12}, {30, 214, 5, 12}, {60, 214, 5, 12},
+                                  {90, 214, 5, 12}, {120, 214, 5, 12}};
+
 void mainCycle() {
     drawScreen();
+    if (drawMode != DRAW_XY && drawMode != DRAW_WATERFALL) {
+        MEAS_update();
+        MEAS_draw();
+    }
     KEYS_scan();
 
     if ((random() & 7) < 3) HAL_GPIO_TogglePin(LED1_GPIO_Port, LED1_Pin);
@@ -46,13 +75,18 @@ void mainCycle() {
     if ((random() & 7) < 3) HAL_GPIO_TogglePin(LED3_GPIO_Port, LED3_Pin);
 #endif
 
-    POINT_COLOR = WHITE;
-    BACK_COLOR = BLACK;
-    LCD_ShowxNum(0, 214, TIM8->CNT, 5, 12, 0x01);
-    LCD_ShowxNum(30, 214, (u32) button1Count, 5, 12, 0x01);
-    LCD_ShowxNum(60, 214, (u32) ii, 5, 12, 0x01);
-    LCD_ShowxNum(90, 214, (u32) time / 10, 5, 12, 0x01);
-    LCD_ShowxNum(120, 214, (u32) firstHalf, 5, 12, 0x01);
+    // hardware scrolled screen would move text with it
+    if (drawMode != DRAW_WATERFALL) {
+        POINT_COLOR = WHITE;
+        BACK_COLOR = BLACK;
+        LCD_ShowReadout(&readouts[0], TIM8->CNT, 0);
+        LCD_ShowReadout(&readouts[1], (u32) button1Count, 0);
+        LCD_ShowReadout(&readouts[2], (u32) ii, 0);
+        LCD_ShowReadout(&readouts[3], (u32) time / 10, 0);
+        LCD_ShowReadout(&readouts[4], (u32) firstHalf, 0);
+    }
+    if (drawMode == DRAW_LAYERS) LAYER_compose();  // readouts are in overlay
+    if (lcdFB || lcdFB8) FB_flush();
 
     delay_ms(50);
 }
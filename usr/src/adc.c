@@ -1,6 +1,7 @@
 #include <_main.h>
 #include <dwt.h>
 #include <graph.h>
+#include <pyramid.h>
 #include <DataBuffer.h>
 #include "adc.h"
 
@@ -51,6 +52,7 @@ const ADC_PARAM ADC_Parameters[ADC_Parameters_Size] = {
 
 uint32_t ADC_Prescaler = ADC_CLOCK_ASYNC_DIV4;
 uint32_t ADC_SampleTime = ADC_SAMPLETIME_1CYCLE_5;
+float ADC_SampleUs = 0.8148148f;  // sample period, microseconds. Startup setup: DIV4, 1.5 cycles
 
 uint16_t ScreenTime = 0;      // index in ScreenTimes
 uint16_t ScreenTime_adj = 0;  // 0-9 shift in ScreenTime
@@ -60,12 +62,17 @@ uint32_t ADCStartTick;         // time when start ADC buffer fill
 uint32_t ADCHalfElapsedTick;   // the last time half buffer fill
 uint32_t ADCElapsedTick;       // the last time buffer fill
 
+ADC_HandleTypeDef hadc2;
+u8 adcDual = 0;                // ADC1 + ADC2 simultaneous, samplesBuffer holds X,Y pairs
+
+static void ADC_setDualParams();
+
 /**
  * Copy of MX_ADC1_Init()
  */
 void ADC_setParams() {
 
-    ADC_ChannelConfTypeDef sConfig;
+    ADC_ChannelConfTypeDef sConfig = {0};
 
     /**Common config
     */
@@ -102,11 +109,89 @@ void ADC_setParams() {
     if (HAL_ADC_ConfigChannel(&hadc1, &sConfig) != HAL_OK)
         Error_Handler();
 
-    HAL_ADC_Start_DMA(&hadc1, (uint32_t *) samplesBuffer, BUF_SIZE);
+    if (adcDual) {
+        ADC_setDualParams();
+    } else if (HAL_ADC_Start_DMA(&hadc1, (uint32_t *) samplesBuffer, BUF_SIZE) != HAL_OK)
+        Error_Handler();
 
     ADCStartTick = DWT_Get_Current_Tick();
 }
 
+/**
+ * ADC2 as slave of ADC1 in regular simultaneous mode.
+ * DAMDF 8 bit format packs both results in one half word: ADC1 - low byte (X), ADC2 - high byte (Y).
+ * Called from ADC_setParams() after ADC1 configured.
+ */
+static void ADC_setDualParams() {
+    ADC_ChannelConfTypeDef sConfig = {0};
+    ADC_MultiModeTypeDef multimode = {0};
+    GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+    // PC4 - ADC12_INP4
+    __HAL_RCC_GPIOC_CLK_ENABLE();
+    GPIO_InitStruct.Pin = GPIO_PIN_4;
+    GPIO_InitStruct.Mode = GPIO_MODE_ANALOG;
+    GPIO_InitStruct.Pull = GPIO_NOPULL;
+    HAL_GPIO_Init(GPIOC, &GPIO_InitStruct);
+
+    hadc2.Instance = ADC2;
+    hadc2.Init = hadc1.Init;
+    hadc2.Init.ConversionDataManagement = ADC_CONVERSIONDATA_DR;  // slave data goes through common register
+    if (HAL_ADC_Init(&hadc2) != HAL_OK)
+        Error_Handler();
+
+    sConfig.Channel = ADC_CHANNEL_4;
+    sConfig.Rank = ADC_REGULAR_RANK_1;
+    sConfig.SamplingTime = ADC_SampleTime;
+    sConfig.SingleDiff = ADC_SINGLE_ENDED;
+    sConfig.OffsetNumber = ADC_OFFSET_NONE;
+    sConfig.Offset = 0;
+    if (HAL_ADC_ConfigChannel(&hadc2, &sConfig) != HAL_OK)
+        Error_Handler();
+
+    multimode.Mode = ADC_DUALMODE_REGSIMULT;
+    multimode.DualModeData = ADC_DUALMODEDATAFORMAT_8_BITS;
+    multimode.TwoSamplingDelay = ADC_TWOSAMPLINGDELAY_1CYCLE;
+    if (HAL_ADCEx_MultiModeConfigChannel(&hadc1, &multimode) != HAL_OK)
+        Error_Handler();
+
+    // one DMA request per pair - move half words, buffer keeps the same size in bytes
+    hdma_adc1.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+    hdma_adc1.Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+    if (HAL_DMA_Init(&hdma_adc1) != HAL_OK)
+        Error_Handler();
+
+    if (HAL_ADCEx_MultiModeStart_DMA(&hadc1, (uint32_t *) samplesBuffer, BUF_SIZE / 2) != HAL_OK)
+        Error_Handler();
+}
+
+/**
+ * Switch between single channel and XY (two channel) acquisition
+ */
+void ADC_setXY(u8 on) {
+    if (adcDual) {
+        HAL_ADCEx_MultiModeStop_DMA(&hadc1);
+        HAL_ADC_DeInit(&hadc2);
+
+        ADC_MultiModeTypeDef multimode = {0};
+        multimode.Mode = ADC_MODE_INDEPENDENT;
+        multimode.DualModeData = ADC_DUALMODEDATAFORMAT_DISABLED;
+        multimode.TwoSamplingDelay = ADC_TWOSAMPLINGDELAY_1CYCLE;
+        if (HAL_ADCEx_MultiModeConfigChannel(&hadc1, &multimode) != HAL_OK)
+            Error_Handler();
+
+        hdma_adc1.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+        hdma_adc1.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+        if (HAL_DMA_Init(&hdma_adc1) != HAL_OK)
+            Error_Handler();
+    } else {
+        HAL_ADC_Stop_DMA(&hadc1);
+    }
+
+    adcDual = on;
+    ADC_setParams();
+}
+
 uint32_t halfCount =0;
 uint32_t cpltCount =10;
 /**
@@ -118,8 +203,10 @@ void HAL_ADC_ConvHalfCpltCallback(ADC_HandleTypeDef* hadc)
 {
     halfCount++;
     firstHalf = 0;
+    acqCount++;
     /* Invalidate Data Cache to get the updated content of the SRAM on the first half of the ADC converted data buffer: 32 bytes */
-    SCB_InvalidateDCache_by_Addr((uint32_t *) &samplesBuffer[0], BUF_SIZE);
+    SCB_InvalidateDCache_by_Addr((uint32_t *) &samplesBuffer[0], BUF_SIZE / 2);
+    if (!adcDual) PYR_update(0);
 }
 
 /**
@@ -131,8 +218,10 @@ void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef* hadc)
 {
     cpltCount++;
     firstHalf = 1;
+    acqCount++;
     /* Invalidate Data Cache to get the updated content of the SRAM on the second half of the ADC converted data buffer: 32 bytes */
-    SCB_InvalidateDCache_by_Addr((uint32_t *) &samplesBuffer[BUF_SIZE/2], BUF_SIZE);
+    SCB_InvalidateDCache_by_Addr((uint32_t *) &samplesBuffer[BUF_SIZE/2], BUF_SIZE / 2);
+    if (!adcDual) PYR_update(1);
 }
 
 void ADC_step_up() {
@@ -182,11 +271,13 @@ void ADC_step(int16_t step) {
     ii = i;
     ADC_Prescaler = ADC_Parameters[i].ADC_Prescaler;
     ADC_SampleTime = ADC_Parameters[i].ADC_SampleTime;
+    ADC_SampleUs = ADC_Parameters[i].SampleTime;
 
     // set X scale
     scaleX = ADC_Parameters[i].ScreenTime / time;
 //*/
-    ADC_setParams();
+    if (adcDual) ADC_setXY(1);  // dual mode can not be reconfigured on the fly
+    else ADC_setParams();
 }
 
 /*uint16_t ICount = 0;
@@ -0,0 +1,52 @@
+#include <DataBuffer.h>
+#include "atlas.h"
+
+/**
+ * Opaque text: whole 12 pixel font expanded to RGB565 once per color pair,
+ * a character is then a plain 6x12 copy to LCD or frame buffer.
+ * Least recently built pair is replaced.
+ */
+
+ALIGN_32BYTES(__SECTION_AXIRAM static u16 atlas[ATLAS_SLOTS][95][ATLAS_H * ATLAS_W]);
+static u16 atlasColor[ATLAS_SLOTS], atlasBack[ATLAS_SLOTS];
+static u8 atlasUsed, atlasNext;
+
+uint32_t AtlasBuilds;
+
+
+static void build(u8 slot, u16 color, u16 back) {
+    u8 mask[ATLAS_H * ATLAS_W];
+
+    for (u8 c = 0; c < 95; c++) {
+        u16 *g = atlas[slot][c];
+        FONT_mask1206(c, mask);
+        for (u32 i = 0; i < ATLAS_H * ATLAS_W; i++)
+            g[i] = mask[i] ? color : back;
+    }
+    SCB_CleanDCache_by_Addr((uint32_t *) atlas[slot], sizeof(atlas[slot]));  // DMA2D reads it
+    atlasColor[slot] = color;
+    atlasBack[slot] = back;
+    AtlasBuilds++;
+}
+
+/**
+ * Row major 6x12 glyph of character in colors
+ */
+const u16 *ATLAS_glyph(u8 ch, u16 color, u16 back) {
+    u8 slot;
+
+    if (ch < ' ' || ch > '~') ch = ' ';
+    for (slot = 0; slot < atlasUsed; slot++)
+        if (atlasColor[slot] == color && atlasBack[slot] == back) break;
+
+    if (slot == atlasUsed) {
+        if (atlasUsed < ATLAS_SLOTS) {
+            slot = atlasUsed++;
+        } else {
+            slot = atlasNext;
+            atlasNext = (u8) ((atlasNext + 1) % ATLAS_SLOTS);
+        }
+        build(slot, color, back);
+    }
+    return atlas[slot][ch - ' '];
+}
@@ -0,0 +1,124 @@
+#include <dwt.h>
+#include <graph.h>
+#include "average.h"
+
+/**
+ * Multi acquisition averaging of trigger aligned frames.
+ * Accumulators keep 2 samples in u16 lanes: even - samples 4k, 4k+2; odd - samples 4k+1, 4k+3
+ * Block:       sum of up to 256 frames of 8 bit samples, fits u16
+ * Exponential: Q8.7 running average, fits s16 lanes for SSUB16/SHADD16/SADD16
+ */
+
+__ALIGNED(4) u8 avgBuffer[AVG_SIZE];
+static u32 avgEven[AVG_SIZE / 4];
+static u32 avgOdd[AVG_SIZE / 4];
+static u32 avgCnt;  // frames in accumulators
+
+u8 avgMode = AVG_BLOCK;
+u8 avgShift = 4;
+u32 avgDone;
+uint32_t AvgAddTick;
+
+
+void AVG_reset() {
+    for (int k = 0; k < AVG_SIZE / 4; k++)
+        avgEven[k] = avgOdd[k] = 0;
+    avgCnt = 0;
+    avgDone = 0;
+}
+
+/**
+ * Accumulators to avgBuffer, shift - fraction bits
+ */
+static void avgOutput(u32 shift) {
+    u8 *out = avgBuffer;
+    for (int k = 0; k < AVG_SIZE / 4; k++, out += 4) {
+        out[0] = (u8) ((avgEven[k] & 0xFFFF) >> shift);
+        out[1] = (u8) ((avgOdd[k] & 0xFFFF) >> shift);
+        out[2] = (u8) (avgEven[k] >> 16 >> shift);
+        out[3] = (u8) (avgOdd[k] >> 16 >> shift);
+    }
+    avgDone++;
+}
+
+static void avgAddBlock(u8 const *p) {
+    for (int k = 0; k < AVG_SIZE / 4; k++, p += 4) {
+        u32 v = __UNALIGNED_UINT32_READ(p);
+        avgEven[k] = __UXTAB16(avgEven[k], v);
+        avgOdd[k] = __UXTAB16(avgOdd[k], v >> 8);
+    }
+
+    if (++avgCnt >= (1U << avgShift)) {
+        avgOutput(avgShift);
+        for (int k = 0; k < AVG_SIZE / 4; k++)
+            avgEven[k] = avgOdd[k] = 0;
+        avgCnt = 0;
+    }
+}
+
+/**
+ * acc += (x - acc) / 2^avgShift for 2 lanes
+ */
+__STATIC_INLINE u32 avgExpLanes(u32 acc, u32 x) {
+    u32 d = __SSUB16(__UXTB16(x) << 7, acc);
+    for (u32 s = avgShift; s > 0; s--)
+        d = __SHADD16(d, 0);
+    return __SADD16(acc, d);
+}
+
+static void avgAddExp(u8 const *p) {
+    if (avgCnt == 0) {
+        // first frame - start from it
+        for (int k = 0; k < AVG_SIZE / 4; k++, p += 4) {
+            u32 v = __UNALIGNED_UINT32_READ(p);
+            avgEven[k] = __UXTB16(v) << 7;
+            avgOdd[k] = __UXTB16(v >> 8) << 7;
+        }
+    } else {
+        for (int k = 0; k < AVG_SIZE / 4; k++, p += 4) {
+            u32 v = __UNALIGNED_UINT32_READ(p);
+            avgEven[k] = avgExpLanes(avgEven[k], v);
+            avgOdd[k] = avgExpLanes(avgOdd[k], v >> 8);
+        }
+    }
+    avgCnt++;
+    avgOutput(7);
+}
+
+/**
+ * Add AVG_SIZE samples frame
+ */
+void AVG_add(u8 const *samples) {
+    uint32_t t0 = DWT_Get_Current_Tick();
+
+    if (avgMode == AVG_EXP) avgAddExp(samples);
+    else avgAddBlock(samples);
+
+    AvgAddTick = DWT_Elapsed_Tick(t0);
+}
+
+/**
+ * Average every triggered frame coming during AVG_ACQ_US, then build graph from result
+ */
+void AVG_acquire() {
+    u32 seq = acqCount;
+    u32 t0 = DWT_Get_Current_Tick();
+
+    while (DWT_Elapsed_Tick(t0) < AVG_ACQ_US * DWT_IN_MICROSEC) {
+        if (!nextAcquisition(&seq))
+            break;
+
+        u8 *samples = samplesBuffer;
+        if (firstHalf != 0) samples += BUF_SIZE / 2;
+
+        int start = triggerStart1ch(samples);
+        if (start == 0 || start > BUF_SIZE / 2 - AVG_SIZE)
+            continue;  // not triggered or not enough samples after trigger
+        AVG_add(samples + start);
+    }
+
+    if (avgDone == 0)
+        buildGraph1ch();  // no result yet
+    else
+        buildGraph(avgBuffer, 0, AVG_SIZE);
+}
@@ -0,0 +1,236 @@
+#include <dwt.h>
+#include <lcd.h>
+#include <stdio.h>
+#include <framebuf.h>
+#include <DataBuffer.h>
+#include <font.h>
+#include "dma2d.h"
+
+/**
+ * Chrom-ART (DMA2D) 2D primitives for frame buffer with MAX_X pixels line.
+ * Registers are set directly, HAL DMA2D driver is not in the project.
+ * Every call waits for its transfer, so CPU drawing can follow at once,
+ * except L8 frame push which runs along with drawing of the next frame.
+ */
+
+// DMA2D modes, CR.MODE
+#define D2D_M2M        0
+#define D2D_M2M_PFC    1
+#define D2D_M2M_BLEND  2
+#define D2D_R2M        3
+
+// pixel formats
+#define D2D_ARGB8888   0
+#define D2D_RGB565     2
+#define D2D_L8         5
+
+#define GLYPH_W  FONT_1206_W
+#define GLYPH_H  FONT_1206_H
+
+u8 lcdD2D = 1;
+
+// 12 pixel font as A8 glyphs, row major - DMA2D can not read 1 bit column major font
+__SECTION_AXIRAM static u8 glyphs[95][GLYPH_H][GLYPH_W];
+
+
+void D2D_init() {
+    __HAL_RCC_DMA2D_CLK_ENABLE();
+
+    for (u8 c = 0; c < 95; c++)
+        FONT_mask1206(c, &glyphs[c][0][0]);
+    SCB_CleanDCache_by_Addr((uint32_t *) glyphs, sizeof(glyphs));
+}
+
+/**
+ * Output area leaves cache: no dirty line may be written over DMA2D result later
+ */
+static void cacheArea(u16 *dst, u16 w, u16 h) {
+    u32 start = (u32) dst & ~31U;
+    u32 end = (u32) (dst + (h - 1) * MAX_X + w);
+    SCB_CleanInvalidateDCache_by_Addr((uint32_t *) start, (int32_t) (end - start));
+}
+
+void D2D_wait() {
+    while (DMA2D->CR & DMA2D_CR_START);
+}
+
+static void output(u16 *dst, u16 w, u16 h) {
+    D2D_wait();
+    cacheArea(dst, w, h);
+    DMA2D->OPFCCR = D2D_RGB565;
+    DMA2D->OMAR = (u32) dst;
+    DMA2D->OOR = MAX_X - w;
+    DMA2D->NLR = (u32) w << DMA2D_NLR_PL_Pos | h;
+}
+
+static void run(u32 mode) {
+    DMA2D->CR = mode << DMA2D_CR_MODE_Pos | DMA2D_CR_START;
+    while (DMA2D->CR & DMA2D_CR_START);
+}
+
+static u32 rgb888(u16 c) {
+    return (u32) (c >> 11) << 19 | (u32) ((c >> 5) & 0x3F) << 10 | (u32) (c & 0x1F) << 3;
+}
+
+/**
+ * Register to memory: rectangle w*h of color
+ */
+void D2D_fill(u16 *dst, u16 w, u16 h, u16 color) {
+    output(dst, w, h);
+    DMA2D->OCOLR = color;
+    run(D2D_R2M);
+}
+
+/**
+ * RGB565 bitmap to frame buffer
+ */
+void D2D_copy(u16 const *src, u16 srcPitch, u16 *dst, u16 w, u16 h) {
+    output(dst, w, h);
+    DMA2D->FGMAR = (u32) src;
+    DMA2D->FGOR = srcPitch - w;
+    DMA2D->FGPFCCR = D2D_RGB565;
+    run(D2D_M2M);
+}
+
+/**
+ * RGB565 bitmap over frame buffer with constant alpha 0..255
+ */
+void D2D_blend(u16 const *src, u16 srcPitch, u16 *dst, u16 w, u16 h, u8 alpha) {
+    output(dst, w, h);
+    DMA2D->FGMAR = (u32) src;
+    DMA2D->FGOR = srcPitch - w;
+    DMA2D->FGPFCCR = D2D_RGB565 | 1U << DMA2D_FGPFCCR_AM_Pos | (u32) alpha << DMA2D_FGPFCCR_ALPHA_Pos;
+    DMA2D->BGMAR = (u32) dst;
+    DMA2D->BGOR = MAX_X - w;
+    DMA2D->BGPFCCR = D2D_RGB565;
+    run(D2D_M2M_BLEND);
+}
+
+/**
+ * L8 (8 bit index) bitmap to RGB565 through ARGB8888 color table
+ */
+void D2D_convertL8(u8 const *src, u16 srcPitch, u32 const *clut, u16 clutSize, u16 *dst, u16 w, u16 h) {
+    // table is loaded once per call, wait for load before transfer
+    D2D_wait();
+    DMA2D->FGCMAR = (u32) clut;
+    DMA2D->FGPFCCR = D2D_L8 | (u32) (clutSize - 1) << DMA2D_FGPFCCR_CS_Pos | DMA2D_FGPFCCR_START;
+    while (DMA2D->FGPFCCR & DMA2D_FGPFCCR_START);
+
+    output(dst, w, h);
+    DMA2D->FGMAR = (u32) src;
+    DMA2D->FGOR = srcPitch - w;
+    run(D2D_M2M_PFC);
+}
+
+/**
+ * Full screen L8 frame through 256 colors table to LCD data register.
+ * LCD data is selected by address bit, so whole frame goes as one
+ * incrementing block from the register address. Does not wait.
+ */
+void D2D_pushL8(u8 const *src, u32 const *clut, u16 *lcdRam) {
+    D2D_wait();
+    DMA2D->FGCMAR = (u32) clut;
+    DMA2D->FGPFCCR = D2D_L8 | 255U << DMA2D_FGPFCCR_CS_Pos | DMA2D_FGPFCCR_START;
+    while (DMA2D->FGPFCCR & DMA2D_FGPFCCR_START);
+
+    DMA2D->OPFCCR = D2D_RGB565;
+    DMA2D->OMAR = (u32) lcdRam;
+    DMA2D->OOR = 0;
+    DMA2D->NLR = (u32) MAX_X << DMA2D_NLR_PL_Pos | MAX_Y;
+    DMA2D->FGMAR = (u32) src;
+    DMA2D->FGOR = 0;
+    DMA2D->CR = D2D_M2M_PFC << DMA2D_CR_MODE_Pos | DMA2D_CR_START;
+}
+
+/**
+ * Alpha only bitmap (A8 or A4) painted with color over frame buffer - glyphs
+ */
+void D2D_alpha(u8 const *src, u8 format, u16 srcPitch, u16 color, u16 *dst, u16 w, u16 h) {
+    output(dst, w, h);
+    DMA2D->FGMAR = (u32) src;
+    DMA2D->FGOR = srcPitch - w;
+    DMA2D->FGPFCCR = format;
+    DMA2D->FGCOLR = rgb888(color);
+    DMA2D->BGMAR = (u32) dst;
+    DMA2D->BGOR = MAX_X - w;
+    DMA2D->BGPFCCR = D2D_RGB565;
+    run(D2D_M2M_BLEND);
+}
+
+/**
+ * Background table for L8 layer under others, foreground one for L8 layer on top.
+ * Tables stay in DMA2D while next transfers switch formats.
+ */
+void D2D_loadCluts(u32 const *bgClut, u32 const *fgClut) {
+    D2D_wait();
+    DMA2D->BGCMAR = (u32) bgClut;
+    DMA2D->BGPFCCR = D2D_L8 | 255U << DMA2D_BGPFCCR_CS_Pos | DMA2D_BGPFCCR_START;
+    while (DMA2D->BGPFCCR & DMA2D_BGPFCCR_START);
+    DMA2D->FGCMAR = (u32) fgClut;
+    DMA2D->FGPFCCR = D2D_L8 | 255U << DMA2D_FGPFCCR_CS_Pos | DMA2D_FGPFCCR_START;
+    while (DMA2D->FGPFCCR & DMA2D_FGPFCCR_START);
+}
+
+/**
+ * Tile of L8 grid, A8 trace painted with color and L8 overlay with
+ * transparent entries (NULL - none). Tables from D2D_loadCluts.
+ */
+void D2D_composeTile(u16 *dst, u8 const *grid, u8 const *trace, u8 const *overlay, u16 color, u16 w, u16 h) {
+    output(dst, w, h);
+    DMA2D->FGMAR = (u32) trace;
+    DMA2D->FGOR = MAX_X - w;
+    DMA2D->FGPFCCR = D2D_A8;
+    DMA2D->FGCOLR = rgb888(color);
+    DMA2D->BGMAR = (u32) grid;
+    DMA2D->BGOR = MAX_X - w;
+    DMA2D->BGPFCCR = D2D_L8;
+    run(D2D_M2M_BLEND);
+    if (overlay == NULL) return;
+
+    DMA2D->FGMAR = (u32) overlay;
+    DMA2D->FGPFCCR = D2D_L8;
+    DMA2D->BGMAR = (u32) dst;
+    DMA2D->BGPFCCR = D2D_RGB565;
+    run(D2D_M2M_BLEND);
+}
+
+/**
+ * 12 pixel font character, same meaning of mode as LCD_ShowChar
+ */
+void D2D_char(u16 x, u16 y, u8 ch, u16 color, u16 back, u8 mode) {
+    u16 *dst = lcdFB + y * MAX_X + x;
+
+    if (mode == 0) D2D_fill(dst, GLYPH_W, GLYPH_H, back);
+    D2D_alpha(&glyphs[ch - ' '][0][0], D2D_A8, GLYPH_W, color, dst, GLYPH_W, GLYPH_H);
+}
+
+/**
+ * Full screen fill and 12 pixel text, CPU against DMA2D, result to debug output
+ */
+void D2D_benchmark() {
+    char buf[100];
+    u32 t0, fill[2], text[2];
+    u8 save = lcdD2D;
+
+    FB_begin(0);
+    for (u8 d = 0; d < 2; d++) {
+        lcdD2D = d;
+
+        t0 = DWT_Get_Current_Tick();
+        LCD_Clear(BLACK);
+        fill[d] = DWT_Elapsed_Tick(t0);
+
+        t0 = DWT_Get_Current_Tick();
+        for (u16 y = 0; y < 10 * 12; y += 12)
+            LCD_ShowString(0, y, MAX_X, 12, 12, "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmn", 0);
+        text[d] = DWT_Elapsed_Tick(t0);
+    }
+    FB_end();
+    lcdD2D = save;
+
+    // 500 characters
+    sprintf(buf, "fill us: cpu %lu d2d %lu; text chars/ms: cpu %lu d2d %lu\n",
+            fill[0] / DWT_IN_MICROSEC, fill[1] / DWT_IN_MICROSEC,
+            500UL * DWT_IN_MICROSEC * 1000 / text[0], 500UL * DWT_IN_MICROSEC * 1000 / text[1]);
+    DBG_Trace(buf);
+}
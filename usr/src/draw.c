@@ -1,7 +1,32 @@
 #include <dwt.h>
 #include "draw.h"
 #include "graph.h"
+#include "persist.h"
+#include "xy.h"
+#include "zoom.h"
+#include "fft.h"
+#include "waterfall.h"
+#include "framebuf.h"
+#include "fade.h"
+#include "layer.h"
 
+u8 drawMode = DRAW_YT;
+u8 drawFB = FB_RGB565;  // draw to frame buffer, pushed to LCD by MDMA or DMA2D
+static u8 lastMode = DRAW_YT;
+u16 gridX[MAX_X];
+u16 gridY[MAX_Y];
+static LCD_Readout drawTick = {170, 227, 8, 12};
+
+
+/**
+ * Grid color of every column and row, 0 - no line. Column lines are over row lines.
+ */
+void gridInit() {
+    for (u16 x = 0; x < MAX_X; x++)
+        gridX[x] = x == 160 ? GRAY : (x != 0 && (x & 31) == 0) ? DARKGRAY : 0;
+    for (u16 y = 0; y < MAX_Y; y++)
+        gridY[y] = y == 128 ? GRAY : (y != 0 && (y & 31) == 0) ? DARKGRAY : BLACK;
+}
 
 void drawFrame() {
     u16 x, y, step = 32;
@@ -33,14 +58,78 @@ void drawFrame() {
 }
 
 void drawScreen() {
-    drawFrame();
+    u32 t0;
 
-    u32 t0 = DWT_Get_Current_Tick();
+    // persistence, XY and waterfall write LCD directly, fading needs L8 buffer, layers - RGB565
+    u8 fb = drawMode == DRAW_FADE || drawMode == DRAW_LAYERS ||
+            (drawFB && drawMode != DRAW_PERSIST && drawMode != DRAW_XY && drawMode != DRAW_WATERFALL &&
+             drawMode != DRAW_DIRTY);
+    u8 enter = drawMode != lastMode;
+    if (!fb) FB_end();
 
-    drawGraph();
+    // XY needs other ADC setup, XY and waterfall keep screen between frames
+    if (enter) {
+        if (lastMode == DRAW_XY) XY_stop();
+        if (lastMode == DRAW_WATERFALL) WF_stop();
+        if (lastMode == DRAW_LAYERS) LAYER_stop();
+        if (drawMode == DRAW_XY) XY_start();
+        if (drawMode == DRAW_WATERFALL) WF_start();
+        if (drawMode == DRAW_DIRTY) {
+            drawFrame();
+            graphDirtyReset();
+        }
+        lastMode = drawMode;
+    }
+    fbKeep = drawMode == DRAW_FADE;
+    if (fb) FB_begin(drawMode == DRAW_FADE || (drawFB == FB_L8 && drawMode != DRAW_LAYERS));
+    if (enter && drawMode == DRAW_FADE) FADE_start();
+    if (enter && drawMode == DRAW_LAYERS) LAYER_start();
+
+    if (drawMode == DRAW_WATERFALL) {
+        drawWaterfall();
+        return;  // scrolled screen - no readouts
+    } else if (drawMode == DRAW_LAYERS) {
+        t0 = DWT_Get_Current_Tick();
+        drawLayers();
+    } else if (drawMode == DRAW_FADE) {
+        t0 = DWT_Get_Current_Tick();
+        drawFade();
+    } else if (drawMode == DRAW_DIRTY) {
+        t0 = DWT_Get_Current_Tick();
+        drawGraphDirty();
+    } else if (drawMode == DRAW_XY) {
+        t0 = DWT_Get_Current_Tick();
+        drawXY();
+    } else if (drawMode == DRAW_PERSIST) {
+        t0 = DWT_Get_Current_Tick();
+        drawPersist();
+    } else if (drawMode == DRAW_FFT) {
+        drawFrame();
+        t0 = DWT_Get_Current_Tick();
+        drawSpectrum();
+    } else if (drawMode == DRAW_ZOOM) {
+        drawFrame();
+        t0 = DWT_Get_Current_Tick();
+        drawZoom();
+    } else if (drawMode == DRAW_ENVELOPE) {
+        drawFrame();
+        t0 = DWT_Get_Current_Tick();
+        drawEnvelope();
+    } else {
+        drawFrame();
+        t0 = DWT_Get_Current_Tick();
+        drawGraph();
+    }
 
     // count time for one circle
     u32 ticks = DWT_Elapsed_Tick(t0);
     POINT_COLOR = YELLOW;
-    LCD_ShowxNum(170, 227, ticks / 168, 8, 12, 9);
+    u8 keep = drawMode == DRAW_XY || drawMode == DRAW_DIRTY || drawMode == DRAW_FADE || drawMode == DRAW_LAYERS;
+    if (keep) {
+        // screen not cleared - opaque, only changed digits
+        BACK_COLOR = BLACK;
+        LCD_ShowReadout(&drawTick, ticks / 168, 0);
+    } else {
+        LCD_ShowxNum(170, 227, ticks / 168, 8, 12, 9);
+    }
 }
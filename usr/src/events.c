@@ -0,0 +1,164 @@
+#include <string.h>
+#include <stdio.h>
+#include <dwt.h>
+#include "events.h"
+
+/**
+ * Event search. One pass over the record: 4 samples per step are skipped
+ * while they stay at the current level, only words with possible
+ * transition are walked sample by sample through the level state machine.
+ */
+
+// level states
+#define ST_UNKNOWN  0  // between levels at record start
+#define ST_LOW      1
+#define ST_UP       2  // left low level, going up
+#define ST_HIGH     3
+#define ST_DOWN     4  // left high level, going down
+
+u8 evLow = 96;
+u8 evHigh = 160;
+u16 evMinWidth = 0;
+u16 evMaxWidth = 0xFFFF;
+EV_EVENT evTable[EV_MAX];
+u16 evCount;
+u8 evOverflow;
+s16 evCurrent = -1;
+
+uint32_t EvSearchTick;
+
+static const char *const evNames[] = {"rise", "fall", "width", "runt"};
+
+
+static void addEvent(u32 pos, u32 width, u8 type) {
+    if (evCount >= EV_MAX) {
+        evOverflow = 1;
+        return;
+    }
+    evTable[evCount].pos = (u16) pos;
+    evTable[evCount].width = (u16) (width > 0xFFFF ? 0xFFFF : width);
+    evTable[evCount].type = type;
+    evCount++;
+}
+
+/**
+ * Event found later than its position - insert at table index at, keeps table ordered
+ */
+static void insertEvent(u32 at, u32 pos, u32 width, u8 type) {
+    if (evCount >= EV_MAX) {
+        evOverflow = 1;
+        return;
+    }
+    memmove(&evTable[at + 1], &evTable[at], (evCount - at) * sizeof(EV_EVENT));
+    evCount++;
+    evTable[at].pos = (u16) pos;
+    evTable[at].width = (u16) (width > 0xFFFF ? 0xFFFF : width);
+    evTable[at].type = type;
+}
+
+/**
+ * Build event table of rec[0..len)
+ * @return number of events
+ */
+int EV_search(u8 const *rec, u32 len) {
+    u32 t0 = DWT_Get_Current_Tick();
+    u32 lo4 = evLow * 0x01010101U, hi4 = evHigh * 0x01010101U;
+    u32 i = 0, k, end;
+    u32 leave = 0;         // where current transition started
+    s32 rise = -1;         // start of current high pulse
+    u32 riseAt = 0;        // table index after its rise event
+    u8 state = ST_UNKNOWN;
+
+    evCount = 0;
+    evOverflow = 0;
+
+    while (i < len) {
+        // whole word at current level - nothing can happen
+        if (i + 4 <= len && !((u32) (rec + i) & 3)) {
+            u32 v = *(u32 const *) (rec + i);
+            if ((state == ST_LOW && __UQSUB8(v, lo4) == 0) ||
+                (state == ST_HIGH && __UQSUB8(hi4, v) == 0)) {
+                i += 4;
+                continue;
+            }
+        }
+
+        end = (i + 4) & ~3U;
+        if (end > len) end = len;
+        for (k = i; k < end; k++) {
+            u8 v = rec[k];
+            switch (state) {
+                case ST_LOW:
+                    if (v > evLow) state = ST_UP, leave = k;
+                    break;
+                case ST_UP:
+                    if (v >= evHigh) {
+                        addEvent(leave, k - leave, EV_RISE);
+                        rise = (s32) leave;
+                        riseAt = evCount;
+                        state = ST_HIGH;
+                    } else if (v <= evLow) {
+                        addEvent(leave, k - leave, EV_RUNT);
+                        state = ST_LOW;
+                    }
+                    break;
+                case ST_HIGH:
+                    if (v < evHigh) state = ST_DOWN, leave = k;
+                    break;
+                case ST_DOWN:
+                    if (v <= evLow) {
+                        addEvent(leave, k - leave, EV_FALL);
+                        if (rise >= 0) {
+                            u32 w = leave - (u32) rise;
+                            if (w < evMinWidth || w > evMaxWidth)
+                                insertEvent(riseAt, (u32) rise, w, EV_WIDTH);
+                        }
+                        state = ST_LOW;
+                    } else if (v >= evHigh) {
+                        addEvent(leave, k - leave, EV_RUNT);
+                        state = ST_HIGH;
+                    }
+                    break;
+                default:
+                    if (v >= evHigh) state = ST_HIGH;
+                    else if (v <= evLow) state = ST_LOW;
+            }
+        }
+        i = end;
+    }
+
+    if (evCurrent >= (s16) evCount) evCurrent = (s16) (evCount - 1);
+    EvSearchTick = DWT_Elapsed_Tick(t0);
+    return evCount;
+}
+
+/**
+ * Select next/previous event
+ * @return selected event index, -1 if table is empty
+ */
+int EV_next() {
+    if (evCount == 0) return evCurrent = -1;
+    if (evCurrent < (s16) evCount - 1) evCurrent++;
+    return evCurrent;
+}
+
+int EV_prev() {
+    if (evCount == 0) return evCurrent = -1;
+    if (evCurrent > 0) evCurrent--;
+    else evCurrent = 0;
+    return evCurrent;
+}
+
+/**
+ * Event table to debug output as text lines: index, position, type, width
+ */
+void EV_export() {
+    char buf[48];
+
+    sprintf(buf, "events %u%s\n", evCount, evOverflow ? "+" : "");
+    DBG_Trace(buf);
+    for (u16 n = 0; n < evCount; n++) {
+        sprintf(buf, "%u %u %s %u\n", n, evTable[n].pos, evNames[evTable[n].type], evTable[n].width);
+        DBG_Trace(buf);
+    }
+}
@@ -0,0 +1,82 @@
+#include <dwt.h>
+#include <graph.h>
+#include <average.h>
+#include <draw.h>
+#include <persist.h>
+#include <framebuf.h>
+#include "fade.h"
+
+/**
+ * Fading traces in L8 frame buffer: every frame draws its trace with own
+ * palette index, only palette is changed to make older traces darker.
+ * Pixels are touched again just when their index is reused.
+ */
+
+static u32 fadeFrame;
+uint32_t FadeEraseTick;
+
+
+void FADE_start() {
+    for (u16 i = FB8_COLORS; i < 256; i++) FB8_setColor((u8) i, BLACK);
+    fadeFrame = 0;
+    drawFrame();
+}
+
+/**
+ * Pixels of index, FADE_AGES frames old and already black, back to grid
+ */
+static void fadeErase(u8 index) {
+    u32 *p = (u32 *) lcdFB8, pattern = index * 0x01010101U;
+    u32 t0 = DWT_Get_Current_Tick();
+
+    for (u32 i = 0; i < FB_PIXELS / 4; i++) {
+        u32 v = p[i] ^ pattern;
+        if (((v - 0x01010101U) & ~v & 0x80808080U) == 0) continue;  // no zero byte
+
+        for (u32 k = 0; k < 4; k++) {
+            if (lcdFB8[i * 4 + k] != index) continue;
+            u16 x = (i * 4 + k) % MAX_X, y = (i * 4 + k) / MAX_X;
+            lcdFB8[i * 4 + k] = FB8_index(gridX[x] ? gridX[x] : gridY[y]);
+            LCD_Damage(x, y, x, y);
+        }
+    }
+    FadeEraseTick = DWT_Elapsed_Tick(t0);
+}
+
+static void fadeSpans(u8 const *mn, u8 const *mx, u8 index) {
+    u8 lo = mn[0], hi = mx[0];
+    for (u16 x = 0; x < MAX_X; x++) {
+        if (x > 0) {
+            lo = mn[x] < mx[x - 1] ? mn[x] : mx[x - 1];
+            hi = mx[x] > mn[x - 1] ? mx[x] : mn[x - 1];
+        }
+        if (hi >= MAX_Y) hi = MAX_Y - 1;
+        LCD_Damage(x, lo, x, hi);
+        for (u8 *p = lcdFB8 + lo * MAX_X + x; lo <= hi; lo++, p += MAX_X) *p = index;
+    }
+}
+
+/**
+ * Age 0 - white, oldest - black, persistence colors in between
+ */
+static void fadePalette() {
+    for (u32 a = 0; a < FADE_AGES; a++) {
+        u8 index = (u8) (FB8_COLORS + (fadeFrame + FADE_AGES - a) % FADE_AGES);
+        u32 level = 255 - a * 256 / FADE_AGES;
+        FB8_setColor(index, a == FADE_AGES - 1 ? BLACK : persistPalette[level]);
+    }
+}
+
+void drawFade() {
+    u8 index = (u8) (FB8_COLORS + fadeFrame % FADE_AGES);
+
+    fadeErase(index);
+    if (acqMode == ACQ_AVERAGE) AVG_acquire();
+    else buildGraph1ch();
+
+    if (graphMode == GRAPH_PEAK) fadeSpans(graphMin, graphMax, index);
+    else fadeSpans(graph, graph, index);
+
+    fadePalette();
+    fadeFrame++;
+}
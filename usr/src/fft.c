@@ -0,0 +1,228 @@
+#include <dwt.h>
+#include <adc.h>
+#include <graph.h>
+#include <DataBuffer.h>
+#include "fft.h"
+
+/**
+ * Spectrum. Radix-2 complex FFT in single precision floats on FPU.
+ * Tables and work buffer are in AXI SRAM, DTCM is taken by display buffers.
+ */
+
+u16 fftSize = 1024;
+u8 fftWindow = FFT_HANN;
+
+__SECTION_AXIRAM static float fftCos[FFT_MAX];      // cos(2*pi*i/FFT_MAX), full period
+__SECTION_AXIRAM static float fftWin[FFT_MAX];      // window over fftWinLen samples
+__SECTION_AXIRAM static float fftBuf[2 * FFT_MAX];  // re, im
+__SECTION_AXIRAM float fftDb[FFT_MAX / 2];
+static float fftRef;  // power of full scale sine bin with current window
+static u32 fftWinLen; // samples covered by window, rest of FFT input is zero padding
+
+uint32_t FFTTick;
+uint32_t FFTDrawTick;
+
+
+/**
+ * cos table by rotation in double precision. Step angle is small,
+ * so its sin and cos are exact from first Taylor terms.
+ */
+void FFT_init() {
+    double x = 2 * 3.14159265358979323846 / FFT_MAX;
+    double c1 = 1 - x * x / 2 + x * x * x * x / 24;
+    double s1 = x - x * x * x / 6 + x * x * x * x * x / 120;
+    double c = 1, s = 0;
+
+    for (u32 i = 0; i < FFT_MAX; i++) {
+        fftCos[i] = (float) c;
+        double t = c * c1 - s * s1;
+        s = s * c1 + c * s1;
+        c = t;
+    }
+    FFT_setup(fftSize, fftWindow);
+}
+
+static inline float cos2pi(u32 i) {
+    return fftCos[i & (FFT_MAX - 1)];
+}
+
+/**
+ * Window table and reference over len samples - record length, not FFT size
+ */
+static void buildWindow(u32 len) {
+    // cos terms of periodic windows
+    static const float coef[][5] = {
+            {1.0f,       0,          0,           0,           0},
+            {0.5f,       0.5f,       0,           0,           0},
+            {0.21557895f, 0.41663158f, 0.277263158f, 0.083578947f, 0.006947368f},
+            {0.35875f,   0.48829f,   0.14128f,    0.01168f,    0},
+    };
+
+    float const *a = coef[fftWindow];
+    float sum = 0;
+    for (u32 n = 0; n < len; n++) {
+        u32 k = n * FFT_MAX / len;  // table index of 2*pi*n/len
+        float w = a[0] - a[1] * cos2pi(k) + a[2] * cos2pi(2 * k)
+                  - a[3] * cos2pi(3 * k) + a[4] * cos2pi(4 * k);
+        fftWin[n] = w;
+        sum += w;
+    }
+    fftWinLen = len;
+
+    // full scale sine: amplitude 128 codes gives bin magnitude 128 * sum(w) / 2
+    fftRef = 64 * sum;
+    fftRef *= fftRef;
+}
+
+/**
+ * Select size (power of 2, FFT_MIN..FFT_MAX) and window, rebuild window table
+ */
+void FFT_setup(u16 size, u8 window) {
+    if (size < FFT_MIN) size = FFT_MIN;
+    if (size > FFT_MAX) size = FFT_MAX;
+    while (size & (size - 1)) size &= size - 1;  // round down to power of 2
+    if (window > FFT_BLACKMAN) window = FFT_HANN;
+    fftSize = size;
+    fftWindow = window;
+    buildWindow(size);
+}
+
+/**
+ * In place radix-2 decimation in time
+ */
+static void fftComplex(float *d, u32 n) {
+    u32 i, j, k, len;
+
+    // bit reversed order
+    for (i = 1, j = 0; i < n; i++) {
+        u32 bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j |= bit;
+        if (i < j) {
+            float t = d[2 * i];
+            d[2 * i] = d[2 * j];
+            d[2 * j] = t;
+            t = d[2 * i + 1];
+            d[2 * i + 1] = d[2 * j + 1];
+            d[2 * j + 1] = t;
+        }
+    }
+
+    for (len = 2; len <= n; len <<= 1) {
+        u32 half = len >> 1, step = FFT_MAX / len;
+        for (k = 0; k < half; k++) {
+            // w = exp(-2*pi*i*k/len)
+            float wr = cos2pi(k * step), wi = -cos2pi(k * step - FFT_MAX / 4);
+            for (i = k; i < n; i += len) {
+                float *a = d + 2 * i, *b = d + 2 * (i + half);
+                float tr = b[0] * wr - b[1] * wi;
+                float ti = b[0] * wi + b[1] * wr;
+                b[0] = a[0] - tr;
+                b[1] = a[1] - ti;
+                a[0] += tr;
+                a[1] += ti;
+            }
+        }
+    }
+}
+
+/**
+ * log2 from float bits: exponent plus quadratic for mantissa in [1, 2)
+ */
+static inline float fastLog2(float x) {
+    union { float f; u32 i; } u = {x};
+    float e = (float) ((s32) ((u.i >> 23) & 0xFF) - 127);
+    u.i = (u.i & 0x007FFFFF) | 0x3F800000;
+    float m = u.f;
+    return e + (-0.34484843f * m + 2.02466578f) * m - 1.67487759f;
+}
+
+/**
+ * Spectrum of first fftSize samples of rec, zero padded if len is shorter
+ */
+void FFT_run(u8 const *rec, u32 len) {
+    u32 t0 = DWT_Get_Current_Tick();
+    u32 n = fftSize, i;
+
+    if (len > n) len = n;
+    if (len != fftWinLen) buildWindow(len);  // zero padded: window covers the record only
+    u32 sum = 0;
+    for (i = 0; i < len; i++) sum += rec[i];
+    float mean = (float) sum / len;  // DC out, else its window leakage hides low bins
+
+    for (i = 0; i < len; i++) {
+        fftBuf[2 * i] = ((float) rec[i] - mean) * fftWin[i];
+        fftBuf[2 * i + 1] = 0;
+    }
+    for (; i < n; i++)
+        fftBuf[2 * i] = fftBuf[2 * i + 1] = 0;
+
+    fftComplex(fftBuf, n);
+
+    // 10*log10(p) = 3.0103*log2(p)
+    float ref = fastLog2(fftRef);
+    for (i = 0; i < n / 2; i++) {
+        float p = fftBuf[2 * i] * fftBuf[2 * i] + fftBuf[2 * i + 1] * fftBuf[2 * i + 1];
+        fftDb[i] = p > 0 ? 3.0103f * (fastLog2(p) - ref) : -FFT_RANGE_DB * 2;
+    }
+    FFTTick = DWT_Elapsed_Tick(t0);
+}
+
+static u8 dbToY(float db) {
+    s32 y = (s32) (-db * MAX_Y / FFT_RANGE_DB);
+    if (y < 0) y = 0;
+    if (y > MAX_Y - 1) y = MAX_Y - 1;
+    return (u8) y;
+}
+
+/**
+ * Markers of FFT_PEAKS largest local maxima with frequency, Hz
+ */
+static void drawPeaks(u32 bins) {
+    u32 peak[FFT_PEAKS] = {0};
+
+    for (u32 i = 1; i < bins - 1; i++) {
+        if (fftDb[i] <= fftDb[i - 1] || fftDb[i] < fftDb[i + 1]) continue;
+        // insert into sorted list
+        for (u32 k = 0; k < FFT_PEAKS; k++) {
+            if (peak[k] == 0 || fftDb[i] > fftDb[peak[k]]) {
+                for (u32 m = FFT_PEAKS - 1; m > k; m--) peak[m] = peak[m - 1];
+                peak[k] = i;
+                break;
+            }
+        }
+    }
+
+    POINT_COLOR = RED;
+    for (u32 k = 0; k < FFT_PEAKS && peak[k] != 0; k++) {
+        u16 x = (u16) (peak[k] * MAX_X / bins);
+        u8 y = dbToY(fftDb[peak[k]]);
+        if (y < 20) y = 20;
+        if (x > MAX_X - 44) x = MAX_X - 44;
+        LCD_Fill(x, y - 6, x + 2, y - 4, RED);
+        u32 hz = (u32) (peak[k] * 1e6f / (fftSize * ADC_SampleUs));
+        LCD_ShowxNum(x, y - 18, hz, 7, 12, 1);
+    }
+}
+
+void drawSpectrum() {
+    __ALIGNED(4) u8 col[MAX_X];
+    u32 bins = fftSize / 2;
+
+    FFT_run(firstHalf ? &samplesBuffer[BUF_SIZE / 2] : samplesBuffer, BUF_SIZE / 2);
+    u32 t0 = DWT_Get_Current_Tick();
+
+    // column - highest bin it covers
+    for (u32 x = 0; x < MAX_X; x++) {
+        u32 b = x * bins / MAX_X, end = (x + 1) * bins / MAX_X;
+        float db = fftDb[b];
+        for (b++; b < end; b++)
+            if (fftDb[b] > db) db = fftDb[b];
+        col[x] = dbToY(db);
+    }
+    drawSpans(col, col, MAX_X, YELLOW);
+    drawPeaks(bins);
+    LCD_Set_Window(0, 0, MAX_X - 1, MAX_Y - 1);
+
+    FFTDrawTick = DWT_Elapsed_Tick(t0);
+}
@@ -0,0 +1,206 @@
+#include <lcd_fmc.h>
+#include <dwt.h>
+#include <DataBuffer.h>
+#include <dma2d.h>
+#include "framebuf.h"
+
+/**
+ * Double frame buffer in AXI SRAM. Frame is drawn by lcd.c functions into
+ * back buffer, then MDMA streams it to the LCD data register while
+ * CPU draws the next frame into the other buffer.
+ * L8 mode: two 8 bit buffers in place of second RGB565 one, DMA2D
+ * converts them through palette straight into LCD data address range.
+ */
+
+ALIGN_32BYTES(__SECTION_AXIRAM static u16 frameBuf[2][FB_PIXELS]);
+static u8 (*const frameBuf8)[FB_PIXELS] = (u8 (*)[FB_PIXELS]) frameBuf[1];
+static u8 fbBack;     // buffer being drawn
+static u8 fbL8;       // format of buffers in use
+static volatile u8 fbPushing;  // transfer started, not yet waited
+u16 *lcdFB = NULL;
+u8 *lcdFB8 = NULL;
+u8 fbKeep;
+
+ALIGN_32BYTES(__SECTION_AXIRAM u32 fb8Clut[256]);  // ARGB8888, DMA2D format
+u16 fb8Colors[FB8_COLORS];
+static u8 fb8Used;
+u16 fb8LastColor;
+u8 fb8LastIndex;
+
+MDMA_HandleTypeDef hmdma_lcd;
+uint32_t FBWaitTick;  // CPU time spent waiting for previous frame push
+uint32_t FBPushStart; // tick of last push start
+uint32_t FBPushEnd;   // tick of last MDMA push end
+
+
+static void pushDone(MDMA_HandleTypeDef *hmdma) {
+    FBPushEnd = DWT_Get_Current_Tick();
+    fbPushing = 0;
+}
+
+void MDMA_IRQHandler() {
+    HAL_MDMA_IRQHandler(&hmdma_lcd);
+}
+
+/**
+ * MDMA channel 0: software request, 240 blocks of one 640 byte row,
+ * source incremented, destination fixed at LCD data address.
+ * Word writes - FMC makes two 16 bit data cycles of each.
+ */
+void FB_init() {
+    __HAL_RCC_MDMA_CLK_ENABLE();
+
+    hmdma_lcd.Instance = MDMA_Channel0;
+    hmdma_lcd.Init.Request = MDMA_REQUEST_SW;
+    hmdma_lcd.Init.TransferTriggerMode = MDMA_REPEAT_BLOCK_TRANSFER;
+    hmdma_lcd.Init.Priority = MDMA_PRIORITY_HIGH;
+    hmdma_lcd.Init.Endianness = MDMA_LITTLE_ENDIANNESS_PRESERVE;
+    hmdma_lcd.Init.SourceInc = MDMA_SRC_INC_WORD;
+    hmdma_lcd.Init.DestinationInc = MDMA_DEST_INC_DISABLE;
+    hmdma_lcd.Init.SourceDataSize = MDMA_SRC_DATASIZE_WORD;
+    hmdma_lcd.Init.DestDataSize = MDMA_DEST_DATASIZE_WORD;
+    hmdma_lcd.Init.DataAlignment = MDMA_DATAALIGN_PACKENABLE;
+    hmdma_lcd.Init.BufferTransferLength = 128;
+    hmdma_lcd.Init.SourceBurst = MDMA_SOURCE_BURST_SINGLE;
+    hmdma_lcd.Init.DestBurst = MDMA_DEST_BURST_SINGLE;
+    hmdma_lcd.Init.SourceBlockAddressOffset = 0;
+    hmdma_lcd.Init.DestBlockAddressOffset = 0;
+    if (HAL_MDMA_Init(&hmdma_lcd) != HAL_OK)
+        Error_Handler();
+    hmdma_lcd.XferCpltCallback = pushDone;
+    HAL_NVIC_SetPriority(MDMA_IRQn, 2, 0);
+    HAL_NVIC_EnableIRQ(MDMA_IRQn);
+
+    for (u32 i = 0; i < 256; i++) fb8Clut[i] = 0xFF000000;
+    fb8Colors[0] = BLACK;
+    fb8Used = 1;
+    fb8LastColor = BLACK;
+    fb8LastIndex = 0;
+}
+
+void FB8_setColor(u8 index, u16 color) {
+    u32 r = color >> 11, g = (color >> 5) & 0x3F, b = color & 0x1F;
+    fb8Clut[index] = 0xFF000000 | (r << 3 | r >> 2) << 16 | (g << 2 | g >> 4) << 8 | (b << 3 | b >> 2);
+}
+
+/**
+ * Index of color, new entry if absent. Full palette gives nearest color.
+ */
+u8 FB8_alloc(u16 color) {
+    u8 i, best = 0;
+    u32 bestDist = ~0U;
+
+    for (i = 0; i < fb8Used; i++)
+        if (fb8Colors[i] == color) break;
+
+    if (i == fb8Used && fb8Used < FB8_COLORS) {
+        fb8Colors[i] = color;
+        FB8_setColor(i, color);
+        fb8Used++;
+    } else if (i == fb8Used) {
+        for (i = 0; i < fb8Used; i++) {
+            s32 dr = (color >> 11) - (fb8Colors[i] >> 11);
+            s32 dg = ((color >> 5) & 0x3F) / 2 - ((fb8Colors[i] >> 5) & 0x3F) / 2;
+            s32 db = (color & 0x1F) - (fb8Colors[i] & 0x1F);
+            u32 d = (u32) (dr * dr + dg * dg + db * db);
+            if (d < bestDist) bestDist = d, best = i;
+        }
+        i = best;
+    }
+    fb8LastColor = color;
+    fb8LastIndex = i;
+    return i;
+}
+
+/**
+ * Wait until previous frame is on LCD. Needed before any direct LCD access.
+ */
+void FB_wait() {
+    if (!fbPushing) return;
+
+    u32 t0 = DWT_Get_Current_Tick();
+    if (fbL8) {
+        D2D_wait();
+        fbPushing = 0;
+    } else {
+        u32 start = HAL_GetTick();
+        while (fbPushing)  // cleared by transfer complete interrupt
+            if (HAL_GetTick() - start > 100) Error_Handler();
+    }
+    FBWaitTick = DWT_Elapsed_Tick(t0);
+}
+
+/**
+ * Redirect drawing to back buffer of RGB565 or L8 format
+ */
+void FB_begin(u8 l8) {
+    if (l8 != fbL8) {
+        FB_wait();  // L8 buffers overlap RGB565 one
+        fbL8 = l8;
+    }
+    lcdFB = l8 ? NULL : frameBuf[fbBack];
+    lcdFB8 = l8 ? frameBuf8[fbBack] : NULL;
+}
+
+/**
+ * Send back buffer to LCD, next frame goes to the other buffer
+ */
+void FB_flush() {
+    u16 *fb = frameBuf[fbBack];
+
+    FB_wait();
+    if (fbL8) SCB_CleanDCache_by_Addr((uint32_t *) frameBuf8[fbBack], FB_PIXELS);
+    else SCB_CleanDCache_by_Addr((uint32_t *) fb, FB_PIXELS * 2);
+
+    lcdFB = NULL;  // window set on LCD itself
+    lcdFB8 = NULL;
+    LCD_Set_Window(0, 0, MAX_X - 1, MAX_Y - 1);
+    LCD_WR_REG(LCD_WR_RAM_CMD);
+
+    FBPushStart = DWT_Get_Current_Tick();
+    if (fbL8) {
+        SCB_CleanDCache_by_Addr((uint32_t *) fb8Clut, sizeof(fb8Clut));
+        D2D_pushL8(frameBuf8[fbBack], fb8Clut, (u16 *) &LCD->LCD_RAM);
+        fbPushing = 1;
+    } else {
+        fbPushing = 1;
+        if (HAL_MDMA_Start_IT(&hmdma_lcd, (u32) fb, (u32) &LCD->LCD_RAM, MAX_X * 2, MAX_Y) != HAL_OK)
+            Error_Handler();
+    }
+
+    // kept frame is drawn over after push
+    if (fbKeep && fbL8) FB_wait();
+    else fbBack ^= 1;
+    FB_begin(fbL8);
+}
+
+/**
+ * Rows of RGB565 back buffer to LCD, buffer is not swapped - band output.
+ * Waits for previous push only.
+ */
+void FB_pushRows(u16 y0, u16 rows) {
+    u16 *fb = frameBuf[fbBack] + y0 * MAX_X;
+    u16 *save = lcdFB;
+
+    FB_wait();
+    SCB_CleanDCache_by_Addr((uint32_t *) fb, rows * MAX_X * 2);
+
+    lcdFB = NULL;  // window set on LCD itself
+    LCD_Set_Window(0, y0, MAX_X - 1, y0 + rows - 1);
+    LCD_WR_REG(LCD_WR_RAM_CMD);
+    lcdFB = save;
+
+    FBPushStart = DWT_Get_Current_Tick();
+    fbPushing = 1;
+    if (HAL_MDMA_Start_IT(&hmdma_lcd, (u32) fb, (u32) &LCD->LCD_RAM, MAX_X * 2, rows) != HAL_OK)
+        Error_Handler();
+}
+
+/**
+ * Back to direct LCD drawing
+ */
+void FB_end() {
+    FB_wait();
+    lcdFB = NULL;
+    lcdFB8 = NULL;
+}
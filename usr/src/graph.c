@@ -1,14 +1,61 @@
 #include <graph.h>
 #include <dwt.h>
 #include <DataBuffer.h>
+#include <trigger.h>
+#include <average.h>
+#include <adc.h>
+#include <lcd_fmc.h>
+#include <draw.h>
 
 
 /**
  * Make and draw oscillogram
  */
 
-uint8_t graph[MAX_X];
-float scaleX = 1;  // no more then 1
+__ALIGNED(4) uint8_t graph[MAX_X];
+__ALIGNED(4) uint8_t graphMin[MAX_X];
+__ALIGNED(4) uint8_t graphMax[MAX_X];
+__ALIGNED(4) uint8_t envMin[MAX_X];  // envelope - min/max of graph columns since reset
+__ALIGNED(4) uint8_t envMax[MAX_X];
+u32 envCount;
+
+// vertical scale: ADC code -> screen Y
+#define GRAPH_CENTER   128   // Y of middle grid line
+#define GRAPH_DIV      32    // pixels per division
+const u16 voltsDiv[] = {10, 20, 50, 100, 200, 500, 1000, 2000};  // mV per division
+u8 vScale = 5;     // index in voltsDiv
+s16 vOffset = 0;   // trace position, pixels up
+u8 vlut[256];
+u16 hlut[256];     // XY mode: X channel code -> screen X, same volts/div
+float scaleX = 1;  // columns per sample. More then 1 - zoom in, interpolated
+u8 graphMode = GRAPH_PEAK;
+u8 acqMode = ACQ_NORMAL;
+u8 graphInterp = 1;  // sin(x)/x interpolation for zoom in, other case - sample repeat
+
+/**
+ * Rebuild code -> pixel table. Higher voltage is higher on screen.
+ * Codes out of screen are clipped to rows 0 and MAX_Y - 1, those rows are clipping markers.
+ */
+void graphSetVertical(u8 scale, s16 offset) {
+    if (scale >= sizeof(voltsDiv) / sizeof(voltsDiv[0]))
+        scale = sizeof(voltsDiv) / sizeof(voltsDiv[0]) - 1;
+    vScale = scale;
+    vOffset = offset;
+
+    // pixels per code, Q16
+    s32 gain = (s32) (((u32) GRAPH_DIV * ADC_VREF_MV << 8) / voltsDiv[scale]);
+    for (s32 code = 0; code < 256; code++) {
+        s32 y = GRAPH_CENTER - vOffset - (((code - 128) * gain + 0x8000) >> 16);
+        if (y < 1) y = 0;
+        else if (y > MAX_Y - 2) y = MAX_Y - 1;
+        vlut[code] = (u8) y;
+
+        s32 x = MAX_X / 2 + (((code - 128) * gain + 0x8000) >> 16);
+        if (x < 0) x = 0;
+        else if (x > MAX_X - 1) x = MAX_X - 1;
+        hlut[code] = (u16) x;
+    }
+}
 
 /**
  * Looking for trigger event position in 1 channel samples array
@@ -16,9 +63,16 @@ float scaleX = 1;  // no more then 1
  */
 int triggerStart1ch(u8 const *samples) {
     int i;
-    u8 trgLvl = 128;
+    u8 trgLvl = trgLevel;
     u8 trgRdy = 0;
 
+    // comparator already latched crossing position - no scan needed
+    if (trgMode == TRG_COMPARATOR) {
+        i = TRG_findLatched((u32) (samples - samplesBuffer), BUF_SIZE / 2);
+        if (i >= 0)
+            return i;
+    }
+
     for (i = 0; i < BUF_SIZE / 2; i++) {
         if (trgRdy == 0) {
             if (samples[i] < trgLvl)
@@ -33,57 +87,423 @@ int triggerStart1ch(u8 const *samples) {
 }
 
 
+/**
+ * Find min and max of n samples. 4 samples per step:
+ * max = mx + sat(v - mx), min = mn - sat(mn - v) for each byte lane.
+ */
+static void minMax1ch(u8 const *p, int n, u8 *pMin, u8 *pMax) {
+    u32 mn = 0xFFFFFFFF, mx = 0, d;
+
+    for (; n >= 4; n -= 4, p += 4) {
+        u32 v = __UNALIGNED_UINT32_READ(p);
+        d = __UQSUB8(v, mx);
+        mx = __UADD8(mx, d);
+        d = __UQSUB8(mn, v);
+        mn = __USUB8(mn, d);
+    }
+
+    // fold 4 lanes to lane 0
+    d = __UQSUB8(mx >> 16, mx);
+    mx = __UADD8(mx, d);
+    d = __UQSUB8(mx >> 8, mx);
+    mx = __UADD8(mx, d);
+    d = __UQSUB8(mn, mn >> 16);
+    mn = __USUB8(mn, d);
+    d = __UQSUB8(mn, mn >> 8);
+    mn = __USUB8(mn, d);
+
+    u8 lo = (u8) mn, hi = (u8) mx;
+    for (; n > 0; n--, p++) {
+        if (*p < lo) lo = *p;
+        if (*p > hi) hi = *p;
+    }
+    *pMin = lo;
+    *pMax = hi;
+}
+
+/**
+ * Sum of n samples, 4 samples per step (|v - 0| accumulated by USADA8)
+ */
+static u32 sum1ch(u8 const *p, int n) {
+    u32 sum = 0;
+
+    for (; n >= 4; n -= 4, p += 4)
+        sum = __USADA8(__UNALIGNED_UINT32_READ(p), 0, sum);
+    for (; n > 0; n--, p++)
+        sum += *p;
+    return sum;
+}
+
+/**
+ * Windowed sinc (Lanczos, a = 4) polyphase filter, Q14, every phase sum is 1.0
+ * Taps p[-3]..p[4] stored in SMLAD pairs order: -3,-1, -2,0, 1,3, 2,4
+ */
+#define SINC_PHASES_BITS 5
+#define SINC_PHASES      (1 << SINC_PHASES_BITS)
+#define SINC_TAPS        8
+
+__ALIGNED(4) static const s16 sincTable[SINC_PHASES][SINC_TAPS] = {
+        {     0,      0,      0,  16384,      0,      0,      0,      0},  //  0/32
+        {   -49,   -443,    158,  16356,    478,     53,   -168,     -1},  //  1/32
+        {   -93,   -850,    304,  16271,    990,    111,   -345,     -4},  //  2/32
+        {  -132,  -1220,    438,  16130,   1533,    173,   -529,     -9},  //  3/32
+        {  -165,  -1551,    560,  15933,   2105,    238,   -719,    -17},  //  4/32
+        {  -193,  -1845,    668,  15685,   2703,    305,   -913,    -26},  //  5/32
+        {  -216,  -2100,    762,  15385,   3326,    374,  -1110,    -37},  //  6/32
+        {  -234,  -2316,    842,  15034,   3970,    445,  -1307,    -50},  //  7/32
+        {  -247,  -2495,    908,  14638,   4631,    516,  -1502,    -65},  //  8/32
+        {  -255,  -2638,    961,  14196,   5308,    586,  -1693,    -81},  //  9/32
+        {  -258,  -2744,   1000,  13711,   5995,    655,  -1877,    -98},  // 10/32
+        {  -258,  -2816,   1025,  13193,   6689,    721,  -2053,   -117},  // 11/32
+        {  -253,  -2856,   1039,  12635,   7388,    784,  -2218,   -135},  // 12/32
+        {  -246,  -2864,   1040,  12050,   8086,    842,  -2370,   -154},  // 13/32
+        {  -235,  -2842,   1030,  11435,   8780,    894,  -2506,   -172},  // 14/32
+        {  -222,  -2794,   1009,  10797,   9466,    941,  -2623,   -190},  // 15/32
+        {  -207,  -2720,    979,  10140,  10140,    979,  -2720,   -207},  // 16/32
+        {  -190,  -2623,    941,   9465,  10798,   1009,  -2794,   -222},  // 17/32
+        {  -172,  -2506,    894,   8779,  11436,   1030,  -2842,   -235},  // 18/32
+        {  -154,  -2370,    842,   8086,  12050,   1040,  -2864,   -246},  // 19/32
+        {  -135,  -2218,    784,   7386,  12637,   1039,  -2856,   -253},  // 20/32
+        {  -117,  -2053,    721,   6689,  13193,   1025,  -2816,   -258},  // 21/32
+        {   -98,  -1877,    655,   5993,  13713,   1000,  -2744,   -258},  // 22/32
+        {   -81,  -1693,    586,   5308,  14196,    961,  -2638,   -255},  // 23/32
+        {   -65,  -1502,    516,   4632,  14637,    908,  -2495,   -247},  // 24/32
+        {   -50,  -1307,    445,   3970,  15034,    842,  -2316,   -234},  // 25/32
+        {   -37,  -1110,    374,   3327,  15384,    762,  -2100,   -216},  // 26/32
+        {   -26,   -913,    305,   2703,  15685,    668,  -1845,   -193},  // 27/32
+        {   -17,   -719,    238,   2104,  15934,    560,  -1551,   -165},  // 28/32
+        {    -9,   -529,    173,   1533,  16130,    438,  -1220,   -132},  // 29/32
+        {    -4,   -345,    111,    990,  16271,    304,   -850,    -93},  // 30/32
+        {    -1,   -168,     53,    478,  16356,    158,   -443,    -49},  // 31/32
+};
+
+/**
+ * Interpolated value between p[0] and p[1]
+ * @param phase position after p[0] in 1/SINC_PHASES of sample
+ */
+static u8 sinc1ch(u8 const *p, u32 phase) {
+    u32 const *c = (u32 const *) sincTable[phase];
+    u32 w0 = __UNALIGNED_UINT32_READ(p - 3);
+    u32 w1 = __UNALIGNED_UINT32_READ(p + 1);
+    s32 acc = 1 << 13;  // rounding
+
+    acc = (s32) __SMLAD(__UXTB16(w0), c[0], (u32) acc);          // p[-3], p[-1]
+    acc = (s32) __SMLAD(__UXTB16(__ROR(w0, 8)), c[1], (u32) acc); // p[-2], p[0]
+    acc = (s32) __SMLAD(__UXTB16(w1), c[2], (u32) acc);          // p[1],  p[3]
+    acc = (s32) __SMLAD(__UXTB16(__ROR(w1, 8)), c[3], (u32) acc); // p[2],  p[4]
+    return (u8) __USAT(acc >> 14, 8);
+}
+
+/**
+ * sinc1ch near record edges - taps outside [0, len) repeat the edge sample
+ */
+static u8 sincEdge(u8 const *samples, int i, int len, u32 phase) {
+    u8 t[SINC_TAPS];
+    for (int k = 0; k < SINC_TAPS; k++) {
+        int n = i - (SINC_TAPS / 2 - 1) + k;
+        t[k] = samples[n < 0 ? 0 : n >= len ? len - 1 : n];
+    }
+    return sinc1ch(t + SINC_TAPS / 2 - 1, phase);
+}
+
+/**
+ * Reduce n samples to graph column j according to graphMode
+ */
+static void buildColumn(u8 const *p, int n, int j) {
+    if (graphMode == GRAPH_PEAK) {
+        u8 lo, hi;
+        minMax1ch(p, n, &lo, &hi);
+        // table is descending: max code is upper pixel
+        graphMin[j] = vlut[hi];
+        graphMax[j] = vlut[lo];
+        graph[j] = vlut[(lo + hi) >> 1];
+    } else {
+        graph[j] = graphMin[j] = graphMax[j] = vlut[sum1ch(p, n) / n]; // arithmetical mean
+    }
+}
+
+/**
+ * Samples per column in Q16.16. Float division only when scaleX changed.
+ */
+static u32 graphStep() {
+    static float lastScaleX = 0;
+    static u32 step = 0x10000;
+
+    if (scaleX != lastScaleX) {
+        lastScaleX = scaleX;
+        step = (u32) (65536.0f / scaleX);
+        if (step == 0) step = 1;
+    }
+    return step;
+}
+
 // start position in buffer
 // number of samples to display
 
 uint32_t BuildGraphTick;
 
 /**
- * Build graph for 1 channels samples array
+ * Build graph from samples[start..len) with given samples per column
+ * @param step samples per column, Q16.16
+ * @return number of built columns
  */
-
-void buildGraph1ch() {
+int buildGraphStep(u8 const *samples, int start, int len, u32 step) {
     uint32_t t0 = DWT_Get_Current_Tick();
-    int i, j;
-    float x;
+    int i, j, n, end;
 
-    u8 *samples = samplesBuffer;
-    if (firstHalf != 0) samples += BUF_SIZE / 2;
+    i = start;
+    if ((step & 0xFFFF) == 0) {
+        // integer decimation - same number of samples in every column
+        n = step >> 16;
+        int cols = (len - start) / n;
+        if (cols > MAX_X) cols = MAX_X;
 
-    x = 0;
-    j = -1;
-    i = triggerStart1ch(samples);
-    for (; i < BUF_SIZE / 2; i++) {
-        if ((int) x != j) {
-            j = (int) x;
-            if (j >= MAX_X) break;
-            graph[j] = samples[i];
+        if (n == 1) {
+            for (j = 0; j < cols; j++)
+                graph[j] = graphMin[j] = graphMax[j] = vlut[samples[start + j]];
         } else {
-            graph[j] = (graph[j] + samples[i]) >> 1; // arithmetical mean
+            for (j = 0; j < cols; j++, i += n)
+                buildColumn(samples + i, n, j);
+        }
+    } else if (step < 0x10000) {
+        // zoom in - column j at sample position start + j*step
+        u32 pos = (u32) start << 16;
+        for (j = 0; j < MAX_X; j++, pos += step) {
+            i = pos >> 16;
+            if (i >= len) break;
+
+            u8 v = samples[i];
+            if (graphInterp) {
+                u32 phase = (pos & 0xFFFF) >> (16 - SINC_PHASES_BITS);
+                if (i >= SINC_TAPS / 2 - 1 && i + SINC_TAPS / 2 < len)
+                    v = sinc1ch(samples + i, phase);
+                else
+                    v = sincEdge(samples, i, len, phase);
+            }
+            graph[j] = graphMin[j] = graphMax[j] = vlut[v];
+        }
+    } else {
+        // fractional decimation - column j gets samples [ceil(j*step), ceil((j+1)*step))
+        u32 pos = 0;
+        for (j = 0; j < MAX_X && i < len; j++, i = end) {
+            pos += step;
+            end = start + (int) ((pos + 0xFFFF) >> 16);
+            if (end > len) end = len;
+            buildColumn(samples + i, end - i, j);
         }
-        x += scaleX;
     }
     BuildGraphTick = DWT_Elapsed_Tick(t0);
+    return j;
+}
+
+/**
+ * Build graph from samples[start..len) with current time scale
+ */
+void buildGraph(u8 const *samples, int start, int len) {
+    buildGraphStep(samples, start, len, graphStep());
+}
+
+/**
+ * Build graph for 1 channels samples array
+ */
+void buildGraph1ch() {
+    u8 *samples = samplesBuffer;
+    if (firstHalf != 0) samples += BUF_SIZE / 2;
+
+    buildGraph(samples, triggerStart1ch(samples), BUF_SIZE / 2);
+}
+
+/**
+ * Wait for next filled half of samples buffer
+ * @param seq last seen acqCount, updated on return
+ * @return 0 if no new data during 10 ms
+ */
+int nextAcquisition(u32 *seq) {
+    u32 t0 = DWT_Get_Current_Tick();
+
+    while (acqCount == *seq) {
+        if (DWT_Elapsed_Tick(t0) > 10000 * DWT_IN_MICROSEC)
+            return 0;
+    }
+    *seq = acqCount;
+    return 1;
 }
 
 uint32_t DrawGraphTick;
 
+/**
+ * Red ticks on screen edges where trace is out of screen
+ */
+static void drawClipMarkers() {
+    for (u16 i = 0; i < MAX_X; i++) {
+        if (graphMin[i] == 0) LCD_Fill(i, 0, i, 3, RED);
+        if (graphMax[i] == MAX_Y - 1) LCD_Fill(i, MAX_Y - 4, i, MAX_Y - 1, RED);
+    }
+}
+
+/**
+ * Column spans [mn..mx], each overlapped with previous column span to keep trace continuous
+ */
+void drawSpans(u8 const *mn, u8 const *mx, u16 cols, u16 color) {
+    if (cols == 0) return;
+    LCD_Fill(0, mn[0], 0, mx[0], color);
+    for (u16 i = 1; i < cols; i++) {
+        u8 lo = mn[i] < mx[i - 1] ? mn[i] : mx[i - 1];
+        u8 hi = mx[i] > mn[i - 1] ? mx[i] : mn[i - 1];
+        LCD_Fill(i, lo, i, hi, color);
+    }
+}
+
 void drawGraph() {
     u8 prev;
 
-    buildGraph1ch();
+    if (acqMode == ACQ_AVERAGE) AVG_acquire();
+    else buildGraph1ch();
     uint32_t t0 = DWT_Get_Current_Tick();
 
     POINT_COLOR = BLUE;
-    prev = graph[0];
-    for (u16 i = 1; i < MAX_X; i++) {
-        //LCD_DrawLine(i - (u16) 1, prev, i, graph[i]);
-        LCD_Fill(i , prev, i, graph[i], POINT_COLOR);
-        prev = graph[i];
+    if (graphMode == GRAPH_PEAK) {
+        drawSpans(graphMin, graphMax, MAX_X, POINT_COLOR);
+    } else {
+        prev = graph[0];
+        for (u16 i = 1; i < MAX_X; i++) {
+            //LCD_DrawLine(i - (u16) 1, prev, i, graph[i]);
+            LCD_Fill(i, prev, i, graph[i], POINT_COLOR);
+            prev = graph[i];
+        }
     }
+    drawClipMarkers();
     LCD_Set_Window(0,0,MAX_X-1,MAX_Y-1);
 
     DrawGraphTick = DWT_Elapsed_Tick(t0);
 //  LCD_ShowxNum(150,227, DrawGraphTick/168,  10,12, 9);
 //  LCD_ShowxNum(190,227, BuildGraphTick/168, 10,12, 9);
 } //*/
+
+/**
+ * Incremental trace. Screen keeps last drawn span of every column,
+ * only pixels leaving the span (back to grid) and entering it are sent.
+ */
+static u8 spanLo[MAX_X], spanHi[MAX_X];  // on screen, lo > hi - empty
+u32 dirtyPixels;  // pixels sent in last frame
+
+void graphDirtyReset() {
+    for (u16 i = 0; i < MAX_X; i++) {
+        spanLo[i] = 1;
+        spanHi[i] = 0;
+    }
+}
+
+/**
+ * Grid pixels of column x, rows y0..y1
+ */
+static void restoreGrid(u16 x, u8 y0, u8 y1) {
+    u16 gx = gridX[x];
+
+    dirtyPixels += y1 - y0 + 1U;
+    LCD_Damage(x, y0, x, y1);
+    if (gx) {
+        LCD_Fill(x, y0, x, y1, gx);
+        return;
+    }
+    LCD_Set_Window(x, y0, x, y1);
+    LCD_WR_REG(LCD_WR_RAM_CMD);
+    for (u16 y = y0; y <= y1; y++)
+        LCD_WR_DATA(gridY[y]);
+}
+
+static void traceSpan(u16 x, u8 y0, u8 y1, u16 color) {
+    dirtyPixels += y1 - y0 + 1U;
+    LCD_Damage(x, y0, x, y1);
+    LCD_Fill(x, y0, x, y1, color);
+}
+
+void drawGraphDirty() {
+    if (acqMode == ACQ_AVERAGE) AVG_acquire();
+    else buildGraph1ch();
+    uint32_t t0 = DWT_Get_Current_Tick();
+
+    dirtyPixels = 0;
+    for (u16 i = 0; i < MAX_X; i++) {
+        // same spans as drawGraph
+        u8 lo, hi;
+        if (graphMode == GRAPH_PEAK) {
+            lo = graphMin[i], hi = graphMax[i];
+            if (i > 0) {
+                if (graphMax[i - 1] < lo) lo = graphMax[i - 1];
+                if (graphMin[i - 1] > hi) hi = graphMin[i - 1];
+            }
+        } else {
+            u8 prev = i > 0 ? graph[i - 1] : graph[0];
+            lo = prev < graph[i] ? prev : graph[i];
+            hi = prev < graph[i] ? graph[i] : prev;
+        }
+
+        u8 ol = spanLo[i], oh = spanHi[i];
+        if (ol > oh) {
+            traceSpan(i, lo, hi, BLUE);
+        } else {
+            // old pixels outside new span
+            if (ol < lo) restoreGrid(i, ol, (u8) (oh < lo ? oh : lo - 1));
+            if (oh > hi) restoreGrid(i, (u8) (ol > hi ? ol : hi + 1), oh);
+            // new pixels outside old span
+            if (lo < ol) traceSpan(i, lo, (u8) (hi < ol ? hi : ol - 1), BLUE);
+            if (hi > oh) traceSpan(i, (u8) (lo > oh ? lo : oh + 1), hi, BLUE);
+        }
+        spanLo[i] = lo;
+        spanHi[i] = hi;
+    }
+    LCD_Set_Window(0, 0, MAX_X - 1, MAX_Y - 1);
+
+    DrawGraphTick = DWT_Elapsed_Tick(t0);
+}
+
+/**
+ * Envelope. Running min/max of every graph column since reset
+ */
+void envelopeReset() {
+    u32 *mn = (u32 *) envMin, *mx = (u32 *) envMax;
+    for (int k = 0; k < MAX_X / 4; k++) {
+        mn[k] = 0xFFFFFFFF;
+        mx[k] = 0;
+    }
+    envCount = 0;
+}
+
+/**
+ * Merge current graph columns into envelope, 4 columns per step
+ */
+void envelopeAdd() {
+    u32 *mn = (u32 *) envMin, *mx = (u32 *) envMax;
+    u32 const *gmn = (u32 const *) graphMin, *gmx = (u32 const *) graphMax;
+
+    for (int k = 0; k < MAX_X / 4; k++) {
+        mn[k] = __USUB8(mn[k], __UQSUB8(mn[k], gmn[k]));
+        mx[k] = __UADD8(mx[k], __UQSUB8(gmx[k], mx[k]));
+    }
+    envCount++;
+}
+
+/**
+ * Envelope mode: add all waveforms coming during ENV_ACQ_US, draw band and last trace
+ */
+void drawEnvelope() {
+    u32 seq = acqCount;
+    u32 t0 = DWT_Get_Current_Tick();
+
+    while (DWT_Elapsed_Tick(t0) < ENV_ACQ_US * DWT_IN_MICROSEC) {
+        if (!nextAcquisition(&seq))
+            break;
+        buildGraph1ch();
+        envelopeAdd();
+    }
+    if (envCount == 0) return;
+
+    drawSpans(envMin, envMax, MAX_X, DARKBLUE);
+
+    // last trace over band
+    POINT_COLOR = BLUE;
+    for (u16 i = 1; i < MAX_X; i++)
+        LCD_Fill(i, graph[i - 1], i, graph[i], POINT_COLOR);
+    LCD_Set_Window(0, 0, MAX_X - 1, MAX_Y - 1);
+}
@@ -3,6 +3,8 @@
 #include <adc.h>
 #include <string.h>
 #include <generator.h>
+#include <draw.h>
+#include <zoom.h>
 
 #define DEBOUNCING_CNT 0
 #define MAX_ENCODER    255 // max encoder value
@@ -55,6 +57,8 @@ void KEYS_scan() {
         }
     }
 
+    if (drawMode == DRAW_ZOOM) zoomSelect(button1Count % 3);
+
     // if encoder has step - do it
     int16_t step = ENC_Get();
     if (step == 0) return;
@@ -64,6 +68,10 @@ void KEYS_scan() {
 
     // choose type of encoder action
     int8_t action = button1Count % (int8_t) 3;
+    if (drawMode == DRAW_ZOOM) {
+        zoomControl(step);
+        return;
+    }
 /*    if (action == 0) {
         ADC_step(step);
     } else if (action == 1) {
@@ -0,0 +1,266 @@
+#include <dwt.h>
+#include <graph.h>
+#include <average.h>
+#include <draw.h>
+#include <dma2d.h>
+#include <framebuf.h>
+#include <DataBuffer.h>
+#include "layer.h"
+
+/**
+ * Layered screen: grid drawn once, trace and overlay (readouts) layers
+ * changed per frame. Only tiles where some layer changed are composed into
+ * the frame buffer, by DMA2D blending or by CPU. Both frame buffers get
+ * each change, so a tile stays dirty for two frames.
+ * Band mode keeps one frame buffer: each tile row is pushed to LCD by MDMA
+ * while CPU composes the next row, rows without dirty tiles are not sent.
+ */
+
+ALIGN_32BYTES(__SECTION_RAM_D2 static u8 gridLayer[FB_PIXELS]);     // L8, opaque
+ALIGN_32BYTES(__SECTION_RAM_D2 static u8 traceLayer[FB_PIXELS]);    // A8 coverage
+ALIGN_32BYTES(__SECTION_RAM_D2 static u8 overlayLayer[FB_PIXELS]);  // L8, LAYER_CLEAR - transparent
+ALIGN_32BYTES(__SECTION_AXIRAM static u32 overlayClut[256]);
+
+static u8 tileDirty[LAYER_TILES_Y][LAYER_TILES_X];    // frame buffers still to compose
+static u32 tileHash[LAYER_TILES_Y][LAYER_TILES_X];    // overlay content
+static u8 tileOverlay[LAYER_TILES_Y][LAYER_TILES_X];  // overlay has pixels
+static u8 traceLo[MAX_X], traceHi[MAX_X];  // trace in layer, lo > hi - none
+static u16 *layerFB;  // frame buffer while overlay is drawn
+
+u8 layerBands = 1;
+u32 layerTiles;
+uint32_t LayerComposeTick;
+
+LAYER_BAND_TIME layerTimeline[LAYER_TILES_Y];
+u32 LayerCpuTick, LayerDmaTick, LayerFrameTick;
+static u32 frameStart;
+static s8 lastBand = -1;  // pushed band with end time not yet taken
+
+
+/**
+ * Grid layer from gridX/gridY, once
+ */
+void LAYER_init() {
+    __HAL_RCC_D2SRAM1_CLK_ENABLE();
+    __HAL_RCC_D2SRAM2_CLK_ENABLE();
+    __HAL_RCC_D2SRAM3_CLK_ENABLE();
+
+    for (u16 y = 0; y < MAX_Y; y++)
+        for (u16 x = 0; x < MAX_X; x++)
+            gridLayer[y * MAX_X + x] = FB8_index(gridX[x] ? gridX[x] : gridY[y]);
+    SCB_CleanDCache_by_Addr((uint32_t *) gridLayer, sizeof(gridLayer));
+}
+
+/**
+ * Frame buffers hold other mode picture - compose all
+ */
+void LAYER_start() {
+    u32 *p = (u32 *) traceLayer;
+    for (u32 i = 0; i < FB_PIXELS / 4; i++) p[i] = 0;
+    for (u16 x = 0; x < MAX_X; x++) traceLo[x] = 1, traceHi[x] = 0;
+
+    for (u16 ty = 0; ty < LAYER_TILES_Y; ty++)
+        for (u16 tx = 0; tx < LAYER_TILES_X; tx++) tileDirty[ty][tx] = 2;
+}
+
+static void markSpan(u16 x, u8 lo, u8 hi) {
+    for (u16 ty = lo / LAYER_TILE_H; ty <= hi / LAYER_TILE_H; ty++)
+        tileDirty[ty][x / LAYER_TILE_W] = 2;
+}
+
+static void fillSpan(u16 x, u8 lo, u8 hi, u8 alpha) {
+    for (u8 *p = traceLayer + lo * MAX_X + x; lo <= hi; lo++, p += MAX_X) *p = alpha;
+}
+
+/**
+ * Trace layer to new graph columns, only changed columns are touched
+ */
+static void traceUpdate(u8 const *mn, u8 const *mx) {
+    u8 lo = mn[0], hi = mx[0];
+
+    for (u16 x = 0; x < MAX_X; x++) {
+        if (x > 0) {
+            lo = mn[x] < mx[x - 1] ? mn[x] : mx[x - 1];
+            hi = mx[x] > mn[x - 1] ? mx[x] : mn[x - 1];
+        }
+        if (hi >= MAX_Y) hi = MAX_Y - 1;
+        if (lo == traceLo[x] && hi == traceHi[x]) continue;
+
+        if (traceLo[x] <= traceHi[x]) {
+            fillSpan(x, traceLo[x], traceHi[x], 0);
+            markSpan(x, traceLo[x], traceHi[x]);
+        }
+        if (lo <= hi) {
+            fillSpan(x, lo, hi, 0xFF);
+            markSpan(x, lo, hi);
+        }
+        traceLo[x] = lo;
+        traceHi[x] = hi;
+    }
+}
+
+/**
+ * Tiles with changed overlay become dirty
+ */
+static void overlayScan() {
+    for (u16 ty = 0; ty < LAYER_TILES_Y; ty++) {
+        for (u16 tx = 0; tx < LAYER_TILES_X; tx++) {
+            u32 const *p = (u32 const *) (overlayLayer + ty * LAYER_TILE_H * MAX_X + tx * LAYER_TILE_W);
+            u32 hash = 0, used = 0;
+            for (u16 r = 0; r < LAYER_TILE_H; r++, p += MAX_X / 4) {
+                for (u16 k = 0; k < LAYER_TILE_W / 4; k++) {
+                    hash = __ROR(hash, 5) ^ p[k];
+                    used |= ~p[k];
+                }
+            }
+            if (hash != tileHash[ty][tx]) {
+                tileHash[ty][tx] = hash;
+                tileDirty[ty][tx] = 2;
+            }
+            tileOverlay[ty][tx] = used != 0;
+        }
+    }
+}
+
+static void composeTile(u32 off, u8 overlay) {
+    for (u16 r = 0; r < LAYER_TILE_H; r++, off += MAX_X) {
+        for (u32 i = off; i < off + LAYER_TILE_W; i++) {
+            u8 o = overlayLayer[i];
+            if (overlay && o != LAYER_CLEAR) lcdFB[i] = fb8Colors[o];
+            else if (traceLayer[i]) lcdFB[i] = LAYER_TRACE_COLOR;
+            else lcdFB[i] = fb8Colors[gridLayer[i]];
+        }
+    }
+}
+
+static void composeTileAt(u16 ty, u16 tx) {
+    u32 off = ty * LAYER_TILE_H * MAX_X + tx * LAYER_TILE_W;
+    layerTiles++;
+    if (lcdD2D)
+        D2D_composeTile(lcdFB + off, gridLayer + off, traceLayer + off,
+                        tileOverlay[ty][tx] ? overlayLayer + off : NULL, LAYER_TRACE_COLOR,
+                        LAYER_TILE_W, LAYER_TILE_H);
+    else composeTile(off, tileOverlay[ty][tx]);
+}
+
+/**
+ * Previous frame timeline is complete when its last band is on LCD
+ */
+static void timelineClose() {
+    u32 cpu = 0, dma = 0, end = 0;
+
+    if (lastBand >= 0) {
+        FB_wait();
+        layerTimeline[lastBand].dmaEnd = FBPushEnd - frameStart;
+        lastBand = -1;
+    }
+    for (u16 b = 0; b < LAYER_TILES_Y; b++) {
+        LAYER_BAND_TIME *t = &layerTimeline[b];
+        cpu += t->cpuEnd - t->cpuStart;
+        dma += t->dmaEnd - t->dmaStart;
+        if (t->cpuEnd > end) end = t->cpuEnd;
+        if (t->dmaEnd > end) end = t->dmaEnd;
+        t->cpuStart = t->cpuEnd = t->dmaStart = t->dmaEnd = 0;
+    }
+    LayerCpuTick = cpu;
+    LayerDmaTick = dma;
+    LayerFrameTick = end;
+}
+
+/**
+ * Leaving layers mode: last band is read by MDMA from the buffer next mode draws to
+ */
+void LAYER_stop() {
+    timelineClose();
+}
+
+/**
+ * Tile row by tile row: compose row, push it, the push runs during next row composition
+ */
+static void composeBands() {
+    timelineClose();
+    frameStart = DWT_Get_Current_Tick();
+
+    for (u16 ty = 0; ty < LAYER_TILES_Y; ty++) {
+        LAYER_BAND_TIME *t = &layerTimeline[ty];
+        u8 dirty = 0;
+
+        t->cpuStart = DWT_Get_Current_Tick() - frameStart;
+        for (u16 tx = 0; tx < LAYER_TILES_X; tx++) {
+            if (tileDirty[ty][tx] == 0) continue;
+            tileDirty[ty][tx] = 0;  // single buffer
+            composeTileAt(ty, tx);
+            dirty = 1;
+        }
+        t->cpuEnd = DWT_Get_Current_Tick() - frameStart;
+        if (!dirty) continue;
+
+        if (lastBand >= 0) {
+            FB_wait();
+            layerTimeline[lastBand].dmaEnd = FBPushEnd - frameStart;
+        }
+        FB_pushRows(ty * LAYER_TILE_H, LAYER_TILE_H);
+        t->dmaStart = FBPushStart - frameStart;
+        lastBand = (s8) ty;
+    }
+    lcdFB = NULL;  // frame is sent, no FB_flush
+}
+
+/**
+ * Dirty tiles into frame buffer, drawing goes back to the frame buffer
+ */
+void LAYER_compose() {
+    u32 t0 = DWT_Get_Current_Tick();
+
+    overlayScan();
+    lcdFB8 = NULL;
+    lcdFB = layerFB;
+
+    if (lcdD2D) {
+        for (u32 i = 0; i < 256; i++) overlayClut[i] = fb8Clut[i];
+        overlayClut[LAYER_CLEAR] = 0;
+        SCB_CleanDCache_by_Addr((uint32_t *) overlayClut, sizeof(overlayClut));
+        SCB_CleanDCache_by_Addr((uint32_t *) fb8Clut, 256 * 4);
+        SCB_CleanDCache_by_Addr((uint32_t *) traceLayer, sizeof(traceLayer));
+        SCB_CleanDCache_by_Addr((uint32_t *) overlayLayer, sizeof(overlayLayer));
+        D2D_loadCluts(fb8Clut, overlayClut);
+    }
+
+    layerTiles = 0;
+    if (layerBands) {
+        composeBands();
+    } else {
+        for (u16 ty = 0; ty < LAYER_TILES_Y; ty++) {
+            for (u16 tx = 0; tx < LAYER_TILES_X; tx++) {
+                if (tileDirty[ty][tx] == 0) continue;
+                tileDirty[ty][tx]--;
+                composeTileAt(ty, tx);
+            }
+        }
+    }
+    LayerComposeTick = DWT_Elapsed_Tick(t0);
+}
+
+/**
+ * Trace layer update, then readouts of this frame are drawn into overlay
+ */
+void drawLayers() {
+    if (acqMode == ACQ_AVERAGE) AVG_acquire();
+    else buildGraph1ch();
+
+    if (graphMode == GRAPH_PEAK) traceUpdate(graphMin, graphMax);
+    else traceUpdate(graph, graph);
+
+    u32 *p = (u32 *) overlayLayer;
+    for (u32 i = 0; i < FB_PIXELS / 4; i++) p[i] = LAYER_CLEAR * 0x01010101U;
+    lcdGeneration++;
+    layerFB = lcdFB;
+    lcdFB = NULL;
+    lcdFB8 = overlayLayer;
+
+    // last frame timeline, microseconds: CPU busy, DMA busy, frame
+    POINT_COLOR = YELLOW;
+    LCD_ShowxNum(170, 214, LayerCpuTick / DWT_IN_MICROSEC, 5, 12, 0);
+    LCD_ShowxNum(210, 214, LayerDmaTick / DWT_IN_MICROSEC, 5, 12, 0);
+    LCD_ShowxNum(250, 214, LayerFrameTick / DWT_IN_MICROSEC, 5, 12, 0);
+}
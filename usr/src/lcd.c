@@ -1,5 +1,8 @@
 #include <lcd_fmc.h>
 #include <lcd.h>
+#include <framebuf.h>
+#include <dma2d.h>
+#include <atlas.h>
 #include "font.h"
 #include "delay.h"
 
@@ -14,6 +17,12 @@ u16 BACK_COLOR = 0xFFFF;  // background color
 // Management LCD important parameters
 _lcd_dev lcddev;
 
+u8 lcdPacked = 1;  // two pixels per FMC store
+u32 lcdGeneration = 1;  // readouts drawn before other generation are gone
+u16 lcdReadoutTop = MAX_Y;
+static LCD_Readout *readoutList[LCD_READOUTS_MAX];
+static u8 readoutCount;
+
 
 void LCD_Init_sequence();
 
@@ -26,6 +35,7 @@ __STATIC_INLINE void LCD_WriteRAM_Prepare(void) {
 //Xpos: abscissa
 //Ypos: ordinate
 void LCD_SetCursor(u16 x, u16 y) {
+    if (lcdFB || lcdFB8) return;  // frame buffer is addressed directly
     LCD_WR_REG(LCD_SET_X);
     LCD_WR_DATA8(x >> 8);
     LCD_WR_DATA8(x & (u16) 0XFF);
@@ -39,6 +49,7 @@ void LCD_SetCursor(u16 x, u16 y) {
 //width,height: width and height of the window, must be greater than 0!!
 // Form size:width*height.
 void LCD_Set_Window(u16 sx, u16 sy, u16 ex, u16 ey) {
+    if (lcdFB || lcdFB8) return;
     LCD_WR_REG(LCD_SET_X);
     LCD_WR_DATA8(sx >> 8);
     LCD_WR_DATA8(sx & (u16) 0XFF);
@@ -52,6 +63,24 @@ void LCD_Set_Window(u16 sx, u16 sy, u16 ex, u16 ey) {
     LCD_WR_DATA8(ey & (u16) 0XFF);
 }
 
+// Vertical scrolling definition: fixed top area, scrolled area, fixed bottom area, lines of GRAM
+void LCD_Scroll_Area(u16 top, u16 height, u16 bottom) {
+    LCD_WR_REG(0x33);
+    LCD_WR_DATA8(top >> 8);
+    LCD_WR_DATA8(top & (u16) 0XFF);
+    LCD_WR_DATA8(height >> 8);
+    LCD_WR_DATA8(height & (u16) 0XFF);
+    LCD_WR_DATA8(bottom >> 8);
+    LCD_WR_DATA8(bottom & (u16) 0XFF);
+}
+
+// Vertical scrolling start address: GRAM line shown first in scrolled area
+void LCD_Scroll(u16 line) {
+    LCD_WR_REG(0x37);
+    LCD_WR_DATA8(line >> 8);
+    LCD_WR_DATA8(line & (u16) 0XFF);
+}
+
 // Set up automatic scanning direction of the LCD
 // NOTE: Additional functions may be affected (especially in 9341/6804 these two wonderful) this function set,
 // So, generally set L2R_U2D can, if you set the scan mode to another may result in the display is not normal.
@@ -160,18 +189,52 @@ void LCD_Scan_Dir(u8 dir) {
 void LCD_DrawPoint(u16 x, u16 y) {
     if (x >= MAX_X || y >= MAX_Y)
         return;
+    if (lcdFB) {
+        lcdFB[y * MAX_X + x] = POINT_COLOR;
+        return;
+    }
+    if (lcdFB8) {
+        lcdFB8[y * MAX_X + x] = FB8_index(POINT_COLOR);
+        return;
+    }
 
     LCD_SetCursor(x, y);       // Set the cursor position
     LCD_WriteRAM_Prepare();    // Start writing GRAM
     LCD_WR_DATA(POINT_COLOR);
 }
 
+// Read point color, 18 bit GRAM data back to RGB565
+//x,y: coordinates
+u16 LCD_ReadPoint(u16 x, u16 y) {
+    u16 r, g, b;
+    if (x >= MAX_X || y >= MAX_Y)
+        return 0;
+    if (lcdFB)
+        return lcdFB[y * MAX_X + x];
+
+    LCD_SetCursor(x, y);
+    LCD_WR_REG(0X2E);      // memory read
+    r = LCD_RD_DATA();     // dummy read
+    r = LCD_RD_DATA();     // R and G, 8 bits each
+    b = LCD_RD_DATA();     // B in high byte
+    g = (r & 0XFF) << 8;
+    return (u16) (((r >> 11) << 11) | ((g >> 10) << 5) | (b >> 11));
+}
+
 // Draw the point fast
 //x,y: coordinates
 //color: color
 void LCD_Fast_DrawPoint(u16 x, u16 y, u16 color) {
     if (x >= MAX_X || y >= MAX_Y)
         return;
+    if (lcdFB) {
+        lcdFB[y * MAX_X + x] = color;
+        return;
+    }
+    if (lcdFB8) {
+        lcdFB8[y * MAX_X + x] = FB8_index(color);
+        return;
+    }
 
     LCD_WR_REG(LCD_SET_X);
     LCD_WR_DATA8(x >> 8);
@@ -360,14 +423,27 @@ void LCD_Clear(u16 color) {
     // get start time
     u32 t0 = DWT_Get_Current_Tick();
 
-    LCD_Set_Window(0, 0, MAX_X - 1, MAX_Y - 1);  // set the cursor position
-    LCD_WriteRAM_Prepare();                  // start writing GRAM
-
-    u32 totalPoints = lcddev.width * lcddev.height;  // get the total number of points
-    for (u32 i = 0; i < totalPoints; i++) {
-        LCD_WR_DATA(color);
+    if (lcdFB && lcdD2D) {
+        D2D_fill(lcdFB, MAX_X, MAX_Y, color);
+    } else if (lcdFB) {
+        u32 *p = (u32 *) lcdFB, c = color | (u32) color << 16;
+        for (u32 i = 0; i < FB_PIXELS / 2; i++) p[i] = c;
+    } else if (lcdFB8) {
+        u32 *p = (u32 *) lcdFB8, c = FB8_index(color) * 0x01010101U;
+        for (u32 i = 0; i < FB_PIXELS / 4; i++) p[i] = c;
+    } else {
+        LCD_Set_Window(0, 0, MAX_X - 1, MAX_Y - 1);  // set the cursor position
+        LCD_WriteRAM_Prepare();                  // start writing GRAM
+
+        u32 totalPoints = lcddev.width * lcddev.height;  // get the total number of points
+        if (lcdPacked) LCD_WR_DATA_N(color, totalPoints);
+        else
+            for (u32 i = 0; i < totalPoints; i++) {
+                LCD_WR_DATA(color);
+            }
     }
 
+    lcdGeneration++;
     u32 LCDClearTick = DWT_Elapsed_Tick(t0);
     POINT_COLOR = YELLOW;
     LCD_ShowxNum(100, 227, LCDClearTick / DWT_IN_MICROSEC, 8, 12, 9);
@@ -383,11 +459,37 @@ void LCD_Fill(u16 sx, u16 sy, u16 ex, u16 ey, u16 color) {
         sy = ey;
         ey = tmp;
     }
+    if (lcdFB || lcdFB8) {
+        // no controller to clip frame buffer writes
+        if (ex > MAX_X - 1) ex = MAX_X - 1;
+        if (ey > MAX_Y - 1) ey = MAX_Y - 1;
+        if (sx > ex || sy > ey) return;
+    }
     u32 totalPoints = (ex - sx + (u16) 1) * (ey - sy + (u16) 1);
 
+    if (lcdFB && lcdD2D && totalPoints >= D2D_MIN_PIXELS) {
+        D2D_fill(lcdFB + sy * MAX_X + sx, ex - sx + 1, ey - sy + 1, color);
+        return;
+    }
+    if (lcdFB) {
+        for (u16 *row = lcdFB + sy * MAX_X + sx; sy <= ey; sy++, row += MAX_X)
+            for (u16 x = 0; x <= ex - sx; x++) row[x] = color;
+        return;
+    }
+    if (lcdFB8) {
+        u8 c = FB8_index(color);
+        for (u8 *row = lcdFB8 + sy * MAX_X + sx; sy <= ey; sy++, row += MAX_X)
+            for (u16 x = 0; x <= ex - sx; x++) row[x] = c;
+        return;
+    }
+
     LCD_Set_Window(sx, sy, ex, ey);          // set the cursor position
-    LCD_WriteRAM_Prepare();                  // start writing GRAM
-    for (int j = 0; j < totalPoints; j++) {  // display colors
+    LCD_WriteRAM_Prepare();                  // start writing GRAM
+    if (lcdPacked) {
+        LCD_WR_DATA_N(color, totalPoints);
+        return;
+    }
+    for (int j = 0; j < totalPoints; j++) {  // display colors
         LCD_WR_DATA(color);
     }
 }
@@ -400,15 +502,51 @@ void LCD_drawBMP(u16 sx, u16 sy, u16 ex, u16 ey, const u16 *bmp) {
     u16 i, j;
     width = ex - sx + (u16) 1;            // get filled width
     height = ey - sy + (u16) 1;           // height
+    if (lcdFB || lcdFB8) {
+        // clipped to frame buffer, bmp lines stay width pixels
+        if (sx > MAX_X - 1 || sy > MAX_Y - 1) return;
+        u16 w = ex > MAX_X - 1 ? MAX_X - sx : width;
+        u16 h = ey > MAX_Y - 1 ? MAX_Y - sy : height;
+        if (lcdFB && lcdD2D) {
+            D2D_copy(bmp, width, lcdFB + sy * MAX_X + sx, w, h);
+        } else if (lcdFB) {
+            for (i = 0; i < h; i++)
+                for (j = 0; j < w; j++)
+                    lcdFB[(sy + i) * MAX_X + sx + j] = bmp[i * width + j];
+        } else {
+            for (i = 0; i < h; i++)
+                for (j = 0; j < w; j++)
+                    lcdFB8[(sy + i) * MAX_X + sx + j] = FB8_index(bmp[i * width + j]);
+        }
+        return;
+    }
     for (i = 0; i < height; i++) {
         LCD_SetCursor(sx, sy + i);    // set the cursor position
-        LCD_WriteRAM_Prepare();       // start writing GRAM
-        for (j = 0; j < width; j++) { // write data
+        LCD_WriteRAM_Prepare();       // start writing GRAM
+        if (lcdPacked) {
+            LCD_WR_DATA_BUF(bmp + i * width, width);
+            continue;
+        }
+        for (j = 0; j < width; j++) { // write data
             LCD_WR_DATA(bmp[i * width + j]);
         }
     }
 }
 
+// Horizontal or vertical span, any order of ends, clipped to screen.
+// On LCD it is one window and one data burst.
+static void LCD_Span(int x1, int y1, int x2, int y2, u16 color) {
+    int t;
+    if (x1 > x2) t = x1, x1 = x2, x2 = t;
+    if (y1 > y2) t = y1, y1 = y2, y2 = t;
+    if (x1 < 0) x1 = 0;
+    if (y1 < 0) y1 = 0;
+    if (x2 >= MAX_X) x2 = MAX_X - 1;
+    if (y2 >= MAX_Y) y2 = MAX_Y - 1;
+    if (x1 > x2 || y1 > y2) return;
+    LCD_Fill((u16) x1, (u16) y1, (u16) x2, (u16) y2, color);
+}
+
 // Draw a line
 //x1,y1: starting point coordinates
 //x2,y2: end coordinates
@@ -434,20 +572,32 @@ void LCD_DrawLine(u16 x1, u16 y1, u16 x2, u16 y2) {
     }
     if (delta_x > delta_y)distance = delta_x; // Select the basic incremental axis
     else distance = delta_y;
+    // same points as one by one drawing, joined in spans along the basic axis
+    u8 horizontal = delta_x > delta_y;
+    int spanRow = uRow, spanCol = uCol;
     for (t = 0; t <= distance + 1; t++)  // draw a line output
     {
-        LCD_DrawPoint(uRow, uCol);       // draw points
         xerr += delta_x;
         yerr += delta_y;
+        int nextRow = uRow, nextCol = uCol;
         if (xerr > distance) {
             xerr -= distance;
-            uRow += incx;
+            nextRow += incx;
         }
         if (yerr > distance) {
             yerr -= distance;
-            uCol += incy;
+            nextCol += incy;
+        }
+        // span ends when the other coordinate changes or at the last point
+        if (t == distance + 1 || (horizontal ? nextCol != uCol : nextRow != uRow)) {
+            LCD_Span(spanRow, spanCol, uRow, uCol, POINT_COLOR);
+            spanRow = nextRow;
+            spanCol = nextCol;
         }
+        uRow = nextRow;
+        uCol = nextCol;
     }
+    LCD_Set_Window(0, 0, MAX_X - 1, MAX_Y - 1);
 }
 
 // Draw a rectangle
@@ -487,6 +637,66 @@ void LCD_Draw_Circle(u16 x0, u16 y0, u8 r) {
     }
 }
 
+// Font bitmap is column major: size/2 columns of csize/(size/2) bytes, MSB on top
+static const u8 *LCD_Glyph(u8 num, u8 size) {
+    if (size == 12) return asc2_1206[num];
+    if (size == 16) return asc2_1608[num];
+    if (size == 24) return asc2_2412[num];
+    return NULL;
+}
+
+// Character on LCD with windows instead of points.
+// Opaque: one window, rows streamed. Overlay: one window per vertical run of set pixels.
+static void LCD_ShowCharBurst(u16 x, u16 y, u8 num, u8 size, u8 mode) {
+    const u8 *glyph = LCD_Glyph(num, size);
+    u8 w = size / 2, colBytes = (size + 7) / 8;
+    if (glyph == NULL) return;
+
+    if (mode == 0) {
+        LCD_Set_Window(x, y, x + w - 1, y + size - 1);
+        LCD_WriteRAM_Prepare();
+        for (u8 row = 0; row < size; row++) {
+            const u8 *p = glyph + row / 8;
+            u8 mask = 0x80 >> (row % 8);
+            for (u8 col = 0; col < w; col++, p += colBytes)
+                LCD_WR_DATA(*p & mask ? POINT_COLOR : BACK_COLOR);
+        }
+    } else {
+        for (u8 col = 0; col < w; col++) {
+            const u8 *p = glyph + col * colBytes;
+            for (u8 row = 0; row < size;) {
+                if (!(p[row / 8] & 0x80 >> (row % 8))) {
+                    row++;
+                    continue;
+                }
+                u8 start = row;
+                while (row < size && (p[row / 8] & 0x80 >> (row % 8))) row++;
+                LCD_Set_Window(x + col, y + start, x + col, y + row - 1);
+                LCD_WriteRAM_Prepare();
+                for (u8 i = start; i < row; i++) LCD_WR_DATA(POINT_COLOR);
+            }
+        }
+    }
+    LCD_Set_Window(0, 0, MAX_X - 1, MAX_Y - 1);
+}
+
+// Pre-rendered glyph: DMA2D copy into frame buffer or one window burst to LCD
+static void LCD_ShowGlyph(u16 x, u16 y, const u16 *g) {
+    if (lcdFB && lcdD2D) {
+        D2D_copy(g, ATLAS_W, lcdFB + y * MAX_X + x, ATLAS_W, ATLAS_H);
+    } else if (lcdFB) {
+        for (u16 row = 0; row < ATLAS_H; row++, g += ATLAS_W)
+            for (u16 col = 0; col < ATLAS_W; col++) lcdFB[(y + row) * MAX_X + x + col] = g[col];
+    } else {
+        LCD_Set_Window(x, y, x + ATLAS_W - 1, y + ATLAS_H - 1);
+        LCD_WriteRAM_Prepare();
+        if (lcdPacked) LCD_WR_DATA_BUF(g, ATLAS_W * ATLAS_H);
+        else
+            for (u16 i = 0; i < ATLAS_W * ATLAS_H; i++) LCD_WR_DATA(g[i]);
+        LCD_Set_Window(0, 0, MAX_X - 1, MAX_Y - 1);
+    }
+}
+
 // Display a character in the specified location
 //x,y: Start coordinates
 //num:characters to be displayed:" "--->"~"
@@ -497,8 +707,20 @@ void LCD_ShowChar(u16 x, u16 y, u8 num, u8 size, u8 mode) {
     u16 y0 = y;
     // get a font character set corresponding to the number of bytes occupied by a dot
     u8 csize = (size / 8 + ((size % 8) ? 1 : 0)) * (size / 2);
+    if (mode == 0 && size == 12 && !lcdFB8 && x + ATLAS_W <= MAX_X && y + ATLAS_H <= MAX_Y) {
+        LCD_ShowGlyph(x, y, ATLAS_glyph(num, POINT_COLOR, BACK_COLOR));
+        return;
+    }
+    if (lcdFB && lcdD2D && size == 12 && x + 6 <= lcddev.width && y + 12 <= lcddev.height) {
+        D2D_char(x, y, num, POINT_COLOR, BACK_COLOR, mode);
+        return;
+    }
     // Setup Window
     num = num - ' ';// values obtained after offset
+    if (!lcdFB && !lcdFB8 && x + size / 2 <= MAX_X && y + size <= MAX_Y) {
+        LCD_ShowCharBurst(x, y, num, size, mode);
+        return;
+    }
     for (t = 0; t < csize; t++) {
         if (size == 12)temp = asc2_1206[num][t];        // call 1206 font
         else if (size == 16)temp = asc2_1608[num][t];    // call 1608 font
@@ -528,6 +750,17 @@ u32 LCD_Pow(u8 m, u8 n) {
     return result;
 }
 
+// Decimal digits of num right aligned in len chars, leading zeros replaced by pad.
+// No division: n / 10 == n * 0xCCCCCCCD >> 35 for any 32 bit n.
+static void LCD_Digits(u32 num, u8 len, char pad, char *out) {
+    for (int t = len - 1; t >= 0; t--) {
+        u32 q = (u32) (((uint64_t) num * 0xCCCCCCCDU) >> 35);
+        out[t] = (char) ('0' + num - q * 10);
+        num = q;
+    }
+    for (u8 t = 0; t + 1 < len && out[t] == '0'; t++) out[t] = pad;
+}
+
 // Show figures, the high is 0, no display
 //x,y : the starting point coordinates
 //len : Digits
@@ -535,19 +768,7 @@ u32 LCD_Pow(u8 m, u8 n) {
 //color: color
 //num: Numerical(0~4294967295);
 void LCD_ShowNum(u16 x, u16 y, u32 num, u8 len, u8 size) {
-    u8 t, temp;
-    u8 enshow = 0;
-    for (t = 0; t < len; t++) {
-        temp = (num / LCD_Pow(10, len - t - 1)) % 10;
-        if (enshow == 0 && t < (len - 1)) {
-            if (temp == 0) {
-                LCD_ShowChar(x + (size / 2) * t, y, ' ', size, 0);
-                continue;
-            } else enshow = 1;
-
-        }
-        LCD_ShowChar(x + (size / 2) * t, y, temp + '0', size, 0);
-    }
+    LCD_ShowxNum(x, y, num, len, size, 0);
 }
 
 // Show figures, the high is 0, or show
@@ -560,18 +781,49 @@ void LCD_ShowNum(u16 x, u16 y, u32 num, u8 len, u8 size) {
 //[6:1]: Reserved
 //[0]:0, non-superimposition display;1, superimposed display.
 void LCD_ShowxNum(u16 x, u16 y, u32 num, u8 len, u8 size, u8 mode) {
-    u8 t, temp;
-    u8 enshow = 0;
-    for (t = 0; t < len; t++) {
-        temp = (num / LCD_Pow(10, len - t - 1)) % 10;
-        if (enshow == 0 && t < (len - 1)) {
-            if (temp == 0) {
-                if (mode & 0X80)LCD_ShowChar(x + (size / (u16) 2) * t, y, '0', size, mode & (u8) 0X01);
-                else LCD_ShowChar(x + (size / (u16) 2) * t, y, ' ', size, mode & (u8) 0X01);
-                continue;
-            } else enshow = 1;
-        }
-        LCD_ShowChar(x + (size / (u16) 2) * t, y, temp + (u8) '0', size, mode & (u8) 0X01);
+    char digits[LCD_READOUT_LEN];
+    if (len > LCD_READOUT_LEN) len = LCD_READOUT_LEN;
+    LCD_Digits(num, len, mode & 0X80 ? '0' : ' ', digits);
+    for (u8 t = 0; t < len; t++)
+        LCD_ShowChar(x + (size / (u16) 2) * t, y, (u8) digits[t], size, mode & (u8) 0X01);
+}
+
+// Number readout, only digits changed since last call are drawn.
+// All digits are drawn after screen clear, on other frame buffer or in other colors.
+// Always non-superimposed, so old digit is erased. mode[7]: filled with 0.
+void LCD_ShowReadout(LCD_Readout *r, u32 num, u8 mode) {
+    char digits[LCD_READOUT_LEN];
+    const void *target = lcdFB ? (const void *) lcdFB : (const void *) lcdFB8;
+    u8 len = r->len > LCD_READOUT_LEN ? LCD_READOUT_LEN : r->len;
+    u8 all = r->generation != lcdGeneration || r->target != target ||
+             r->color != POINT_COLOR || r->back != BACK_COLOR;
+
+    LCD_Digits(num, len, mode & 0X80 ? '0' : ' ', digits);
+    for (u8 t = 0; t < len; t++) {
+        if (!all && digits[t] == r->shown[t]) continue;
+        LCD_ShowChar(r->x + (r->size / (u16) 2) * t, r->y, (u8) digits[t], r->size, 0);
+        r->shown[t] = digits[t];
+    }
+    r->generation = lcdGeneration;
+    r->target = target;
+    r->color = POINT_COLOR;
+    r->back = BACK_COLOR;
+
+    if (!r->listed && readoutCount < LCD_READOUTS_MAX) {
+        readoutList[readoutCount++] = r;
+        r->listed = 1;
+        if (r->y < lcdReadoutTop) lcdReadoutTop = r->y;
+    }
+}
+
+// Keep-screen modes draw traces over readouts without screen clear:
+// readouts crossing (x0,y0)-(x1,y1) are drawn whole next time.
+void LCD_Damage(u16 x0, u16 y0, u16 x1, u16 y1) {
+    if (y1 < lcdReadoutTop) return;
+    for (u8 i = 0; i < readoutCount; i++) {
+        LCD_Readout *r = readoutList[i];
+        if (x1 < r->x || x0 >= r->x + r->len * (r->size / 2) || y1 < r->y || y0 >= r->y + r->size) continue;
+        r->generation = 0;
     }
 }
 
@@ -0,0 +1,146 @@
+#include <stdio.h>
+#include <lcd_fmc.h>
+#include <lcd.h>
+#include "lcd_timing.h"
+
+/**
+ * FMC write timing of LCD bank (BWTR1, extended mode) tuned at start-up:
+ * every field is stepped down while test rows read back from GRAM intact,
+ * then a margin is added. Read timing (BTR1) is kept from MX_FMC_Init,
+ * GRAM reads are the slow side of the panel and are the reference here.
+ */
+
+#define FIELDS 3
+
+// fields of BWTR1 stepped down in this order: position, smallest value
+static const struct {
+    u8 pos, min;
+} fields[FIELDS] = {
+        {FMC_BWTRx_DATAST_Pos,  1},
+        {FMC_BWTRx_ADDSET_Pos,  0},
+        {FMC_BWTRx_BUSTURN_Pos, 0},
+};
+
+u32 lcdWriteMBs10;
+
+
+static u32 getField(u32 bwtr, u8 i) {
+    return (bwtr >> fields[i].pos) & (fields[i].pos == FMC_BWTRx_DATAST_Pos ? 0xFF : 0xF);
+}
+
+static u32 setField(u32 bwtr, u8 i, u32 v) {
+    u32 mask = (fields[i].pos == FMC_BWTRx_DATAST_Pos ? 0xFFU : 0xFU) << fields[i].pos;
+    return (bwtr & ~mask) | (v << fields[i].pos);
+}
+
+static void setTiming(u32 bwtr) {
+    FMC_Bank1E_R->BWTR[0] = bwtr;
+    __DSB();
+}
+
+/**
+ * Two passes over one row: alternating complementary values, then pseudo random
+ */
+static u8 rowOk() {
+    u32 seed = 0x1234567;
+
+    for (u8 pass = 0; pass < 2; pass++) {
+        u32 s = seed;
+        LCD_Set_Window(0, LCD_TUNE_ROW, MAX_X - 1, LCD_TUNE_ROW);
+        LCD_WR_REG(LCD_WR_RAM_CMD);
+        for (u16 x = 0; x < MAX_X; x++) {
+            s = s * 1664525 + 1013904223;
+            LCD_WR_DATA(pass == 0 ? ((x & 1) ? 0x5555 ^ (u16) x : 0xAAAA ^ (u16) ~x) : (u16) (s >> 16));
+        }
+
+        s = seed;
+        for (u16 x = 0; x < MAX_X; x++) {
+            s = s * 1664525 + 1013904223;
+            u16 v = pass == 0 ? ((x & 1) ? 0x5555 ^ (u16) x : 0xAAAA ^ (u16) ~x) : (u16) (s >> 16);
+            if (LCD_ReadPoint(x, LCD_TUNE_ROW) != v) return 0;
+        }
+        seed = s;
+    }
+    return 1;
+}
+
+/**
+ * Full screen LCD_Fill, 0.1 MB/s
+ */
+static u32 measure() {
+    u32 t0 = DWT_Get_Current_Tick();
+    LCD_Fill(0, 0, MAX_X - 1, MAX_Y - 1, BLACK);
+    (void) LCD_RD_DATA();  // write FIFO drained before the read
+    u32 us = DWT_Elapsed_Tick(t0) / DWT_IN_MICROSEC;
+    return us ? MAX_X * MAX_Y * 2 * 10 / us : 0;
+}
+
+void LCD_TuneTiming() {
+    char buf[120];
+    u32 start = FMC_Bank1E_R->BWTR[0], best = start;
+    u8 failed = 0;
+
+    u32 before = measure();
+    if (!rowOk()) {
+        DBG_Trace("LCD read back failed, FMC timing not tuned\n");
+        lcdWriteMBs10 = before;
+        LCD_Set_Window(0, 0, MAX_X - 1, MAX_Y - 1);  // rowOk left test row window
+        return;
+    }
+
+    // each field down while test passes
+    for (u8 i = 0; i < FIELDS; i++) {
+        while (getField(best, i) > fields[i].min) {
+            u32 next = setField(best, i, getField(best, i) - 1);
+            setTiming(next);
+            if (!rowOk()) {
+                failed = 1;
+                break;
+            }
+            best = next;
+        }
+        setTiming(best);
+    }
+
+    // margin: one step, data phase a quarter more; never slower than start
+    for (u8 i = 0; i < FIELDS; i++) {
+        u32 v = getField(best, i), m = v + 1 + (fields[i].pos == FMC_BWTRx_DATAST_Pos ? v / 4 : 0);
+        if (m > getField(start, i)) m = getField(start, i);
+        best = setField(best, i, m);
+    }
+    setTiming(best);
+
+    // wrong commands could come during failed steps
+    if (failed) {
+        LCD_Init_sequence();
+        LCD_Display_Dir(1);
+    }
+    if (!rowOk()) {
+        best = start;
+        setTiming(best);
+    }
+
+    lcdWriteMBs10 = measure();
+    sprintf(buf, "LCD write ADDSET %lu DATAST %lu BUSTURN %lu: %lu.%lu MB/s, was %lu.%lu\n",
+            getField(best, 1), getField(best, 0), getField(best, 2),
+            lcdWriteMBs10 / 10, lcdWriteMBs10 % 10, before / 10, before % 10);
+    DBG_Trace(buf);
+}
+
+/**
+ * LCD_Fill with 16 bit stores against packed 32 bit ones
+ */
+void LCD_BenchWrite() {
+    char buf[80];
+    u8 save = lcdPacked;
+
+    lcdPacked = 0;
+    u32 single = measure();
+    lcdPacked = 1;
+    u32 packed = measure();
+    lcdPacked = save;
+
+    sprintf(buf, "LCD fill 16 bit stores %lu.%lu MB/s, 32 bit %lu.%lu MB/s\n",
+            single / 10, single % 10, packed / 10, packed % 10);
+    DBG_Trace(buf);
+}
@@ -0,0 +1,203 @@
+#include <string.h>
+#include <dwt.h>
+#include <adc.h>
+#include <lcd.h>
+#include <DataBuffer.h>
+#include "measure.h"
+
+/**
+ * Automatic measurements. One pass over the record collects min/max
+ * (4 lanes), sum (USADA8), sum of squares (SMLAD) and edges.
+ * Edges use 10% / 50% / 90% levels of previous record top and base, so no
+ * second pass: state goes low below 10%, high above 90%, edge time is the last 50% crossing.
+ * Words staying at current level are not walked sample by sample.
+ */
+
+// edge states
+#define ST_UNKNOWN  0
+#define ST_LOW      1
+#define ST_HIGH     2
+
+MEAS_VALUES meas;
+static u8 lvl10, lvl50, lvl90;  // levels from previous record
+static u8 lvlValid;
+
+uint32_t MeasTick;
+
+
+/**
+ * Integer square root, bit by bit
+ */
+static u32 isqrt(u32 x) {
+    u32 r = 0, b = 1U << 30;
+
+    while (b > x) b >>= 2;
+    for (; b != 0; b >>= 2) {
+        if (x >= r + b) {
+            x -= r + b;
+            r = (r >> 1) + b;
+        } else {
+            r >>= 1;
+        }
+    }
+    return r;
+}
+
+/**
+ * Measure p[0..len), len - multiple of 4, p aligned to 4. len up to 32K samples (SMLAD sum).
+ */
+void MEAS_run(u8 const *p, u32 len) {
+    u32 t0 = DWT_Get_Current_Tick();
+    u32 const *w = (u32 const *) p;
+    u32 mx = 0, mn = 0xFFFFFFFF, d;
+    u32 sum = 0, sq = 0;
+    u32 b4 = lvl10 * 0x01010101U, t4 = lvl90 * 0x01010101U;
+
+    u8 state = lvlValid ? ST_UNKNOWN : 0xFF;  // 0xFF - no edge search
+    u8 side = 0;
+    u32 midCross = 0, lastBelow = 0, lastAbove = 0, curRise = 0;
+    u32 nRise = 0, firstRise = 0, lastRise = 0, highTime = 0;
+    s32 pending = -1;                        // high time of last complete pulse
+    u32 riseSum = 0, nRiseT = 0, fallSum = 0, nFallT = 0;
+    u32 topSum = 0, topN = 0, baseSum = 0, baseN = 0;
+
+    for (u32 i = 0; i < len; i += 4) {
+        u32 v = *w++;
+
+        d = __UQSUB8(v, mx);
+        mx = __UADD8(mx, d);
+        d = __UQSUB8(mn, v);
+        mn = __USUB8(mn, d);
+        sum = __USADA8(v, 0, sum);
+        u32 e = __UXTB16(v), o = __UXTB16(__ROR(v, 8));
+        sq = __SMLAD(e, e, sq);
+        sq = __SMLAD(o, o, sq);
+
+        if (state == ST_LOW && __UQSUB8(v, b4) == 0) {
+            baseSum = __USADA8(v, 0, baseSum), baseN += 4, lastBelow = i + 3;
+            continue;
+        }
+        if (state == ST_HIGH && __UQSUB8(t4, v) == 0) {
+            topSum = __USADA8(v, 0, topSum), topN += 4, lastAbove = i + 3;
+            continue;
+        }
+        if (state == 0xFF)
+            continue;
+
+        for (u32 k = i; k < i + 4; k++) {
+            u8 s = p[k];
+            u8 sd = s >= lvl50;
+            if (sd != side) side = sd, midCross = k;
+            if (sd) topSum += s, topN++;
+            else baseSum += s, baseN++;
+            if (s <= lvl10) lastBelow = k;
+            if (s >= lvl90) lastAbove = k;
+
+            if (state == ST_LOW) {
+                if (s >= lvl90) {
+                    state = ST_HIGH;
+                    riseSum += k - lastBelow, nRiseT++;
+                    if (nRise == 0) firstRise = midCross;
+                    else if (pending >= 0) highTime += (u32) pending;
+                    pending = -1;
+                    lastRise = curRise = midCross;
+                    nRise++;
+                }
+            } else if (state == ST_HIGH) {
+                if (s <= lvl10) {
+                    state = ST_LOW;
+                    fallSum += k - lastAbove, nFallT++;
+                    if (nRise > 0) pending = (s32) (midCross - curRise);
+                }
+            } else {
+                if (s <= lvl10) state = ST_LOW;
+                else if (s >= lvl90) state = ST_HIGH;
+            }
+        }
+    }
+
+    // fold 4 lanes to lane 0
+    d = __UQSUB8(mx >> 16, mx);
+    mx = __UADD8(mx, d);
+    d = __UQSUB8(mx >> 8, mx);
+    mx = __UADD8(mx, d);
+    d = __UQSUB8(mn, mn >> 16);
+    mn = __USUB8(mn, d);
+    d = __UQSUB8(mn, mn >> 8);
+    mn = __USUB8(mn, d);
+    u8 lo = (u8) mn, hi = (u8) mx;
+
+    meas.vmin = (u16) (lo * ADC_VREF_MV >> 8);
+    meas.vmax = (u16) (hi * ADC_VREF_MV >> 8);
+    meas.vpp = meas.vmax - meas.vmin;
+    meas.mean = (u16) ((float) sum / len * ADC_VREF_MV / 256);
+    meas.rms = (u16) (isqrt((u32) (((uint64_t) sq << 8) / len)) * ADC_VREF_MV >> 12);  // sqrt of Q8 is Q4
+
+    float ns = ADC_SampleUs * 1000;
+    if (nRise >= 2) {
+        u32 span = lastRise - firstRise;
+        meas.period = (u32) (span * ns / (nRise - 1));
+        meas.freq = (u32) (1e9f / meas.period);
+        meas.duty = (u8) (highTime * 100 / span);
+    } else {
+        meas.period = meas.freq = 0;
+        meas.duty = 0;
+    }
+    meas.rise = nRiseT ? (u32) (riseSum * ns / nRiseT) : 0;
+    meas.fall = nFallT ? (u32) (fallSum * ns / nFallT) : 0;
+    // top and base - mean of samples above and below 50%, min and max until edges found
+    u32 top = hi, base = lo;
+    if (topN && baseN) {
+        top = topSum / topN;
+        base = baseSum / baseN;
+    }
+    meas.overshoot = 0;
+    if (top > base && hi > top)
+        meas.overshoot = (u8) ((hi - top) * 100 / (top - base));
+
+    // levels for next record
+    lvlValid = top - base >= MEAS_MIN_SWING;
+    lvl10 = (u8) (base + (top - base) / 10);
+    lvl90 = (u8) (top - (top - base) / 10);
+    lvl50 = (u8) ((base + top) >> 1);
+
+    MeasTick = DWT_Elapsed_Tick(t0);
+}
+
+/**
+ * Measure last filled half of samples buffer
+ */
+void MEAS_update() {
+    if (adcDual) return;  // buffer holds XY pairs
+    MEAS_run(firstHalf ? &samplesBuffer[BUF_SIZE / 2] : samplesBuffer, BUF_SIZE / 2);
+}
+
+static u16 showValue(u16 x, u16 y, const char *label, u32 value, u8 len) {
+    LCD_ShowString(x, y, 24, 12, 12, label, 0);
+    x += (u16) (strlen(label) * 6);
+    LCD_ShowxNum(x, y, value, len, 12, 0);
+    return (u16) (x + len * 6 + 6);
+}
+
+/**
+ * Two status rows: voltages (mV), times (Hz, ns, %)
+ */
+void MEAS_draw() {
+    u16 x, y = MEAS_Y;
+
+    POINT_COLOR = WHITE;
+    BACK_COLOR = BLACK;
+    x = showValue(0, y, "pp", meas.vpp, 4);
+    x = showValue(x, y, "mn", meas.vmin, 4);
+    x = showValue(x, y, "mx", meas.vmax, 4);
+    x = showValue(x, y, "av", meas.mean, 4);
+    showValue(x, y, "rms", meas.rms, 4);
+
+    y += 12;
+    x = showValue(0, y, "F", meas.freq, 7);
+    x = showValue(x, y, "T", meas.period, 8);
+    x = showValue(x, y, "D", meas.duty, 3);
+    x = showValue(x, y, "r", meas.rise, 6);
+    x = showValue(x, y, "f", meas.fall, 6);
+    showValue(x, y, "o", meas.overshoot, 3);
+}
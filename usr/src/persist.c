@@ -0,0 +1,144 @@
+#include <lcd_fmc.h>
+#include <dwt.h>
+#include <graph.h>
+#include <draw.h>
+#include <DataBuffer.h>
+#include "persist.h"
+
+/**
+ * Digital phosphor: every waveform adds hits into histogram,
+ * hits decay every frame and displayed through color palette.
+ */
+
+// column major, so a column span is contiguous. In DTCM - fastest for CPU.
+__ALIGNED(4) static u8 persistHist[MAX_X][PERSIST_ROWS];
+u16 persistPalette[256];  // also heat palette of waterfall
+
+u8 persistDecay = 3;
+u32 persistWaves;
+uint32_t PersistAddTick;
+
+
+/**
+ * Palette: black - blue - cyan - yellow - white
+ */
+void PERSIST_init() {
+    for (int i = 0; i < 256; i++) {
+        u32 r, g, b;
+        if (i < 64) {
+            r = 0, g = 0, b = (u32) i * 4;
+        } else if (i < 128) {
+            r = 0, g = (u32) (i - 64) * 4, b = 255;
+        } else if (i < 192) {
+            r = (u32) (i - 128) * 4, g = 255, b = (u32) (191 - i) * 4;
+        } else {
+            r = 255, g = 255, b = (u32) (i - 192) * 4;
+        }
+        persistPalette[i] = (u16) (((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3));
+    }
+    PERSIST_clear();
+}
+
+void PERSIST_clear() {
+    u32 *p = (u32 *) persistHist;
+    for (u32 i = 0; i < sizeof(persistHist) / 4; i++) p[i] = 0;
+}
+
+/**
+ * Saturated add of PERSIST_HIT to hist[lo..hi], 4 rows per step
+ */
+static void addSpan(u8 *col, u32 lo, u32 hi) {
+    u8 *p = col + lo, *end = col + hi + 1;
+
+    for (; p < end && ((u32) p & 3); p++)
+        *p = (u8) __USAT(*p + PERSIST_HIT, 8);
+    for (; p + 4 <= end; p += 4)
+        *(u32 *) p = __UQADD8(*(u32 *) p, PERSIST_HIT * 0x01010101U);
+    for (; p < end; p++)
+        *p = (u8) __USAT(*p + PERSIST_HIT, 8);
+}
+
+/**
+ * Rasterize current graph (min/max columns) into histogram
+ */
+void PERSIST_add() {
+    uint32_t t0 = DWT_Get_Current_Tick();
+
+    addSpan(persistHist[0], graphMin[0], graphMax[0]);
+    for (u16 i = 1; i < MAX_X; i++) {
+        // overlapped with previous column span, same as drawGraph
+        u8 lo = graphMin[i] < graphMax[i - 1] ? graphMin[i] : graphMax[i - 1];
+        u8 hi = graphMax[i] > graphMin[i - 1] ? graphMax[i] : graphMin[i - 1];
+        addSpan(persistHist[i], lo, hi);
+    }
+    persistWaves++;
+    PersistAddTick = DWT_Elapsed_Tick(t0);
+}
+
+/**
+ * count -= (count >> persistDecay) + 1, 4 counts per step
+ */
+void PERSIST_decay() {
+    u32 *p = (u32 *) persistHist;
+    u32 mask = (0xFFU >> persistDecay) * 0x01010101U;
+
+    for (u32 i = 0; i < sizeof(persistHist) / 4; i++) {
+        u32 v = p[i];
+        v = __UQSUB8(v, (v >> persistDecay) & mask);
+        p[i] = __UQSUB8(v, 0x01010101U);
+    }
+}
+
+/**
+ * Draw histogram over whole screen, one column window per column.
+ * Empty cells show the grid. Counts are scaled to palette by the count of
+ * a cell hit by every wave of the frame: (waves - 1) << persistDecay at balance with decay.
+ */
+void PERSIST_draw() {
+    static u16 colors[256];
+    static u32 lastFull = 0;
+    u32 full = ((persistWaves > 1 ? persistWaves - 1 : 1) * PERSIST_HIT) << persistDecay;
+
+    if (full > 255) full = 255;
+    if (persistWaves != 0 && full != lastFull) {  // no waves - keep scale while counts decay
+        lastFull = full;
+        for (u32 c = 1; c < 256; c++) {
+            u32 i = c * 255 / full;
+            if (i < 32) i = 32;  // single hits still visible
+            colors[c] = persistPalette[i > 255 ? 255 : i];
+        }
+    }
+
+    lcdGeneration++;  // whole screen rewritten
+    for (u16 x = 0; x < MAX_X; x++) {
+        u8 const *col = persistHist[x];
+        u16 gx = gridX[x];
+
+        LCD_Set_Window(x, 0, x, MAX_Y - 1);
+        LCD_WR_REG(LCD_WR_RAM_CMD);
+        for (u16 y = 0; y < MAX_Y; y++) {
+            u8 c = col[y];
+            if (c != 0) LCD_WR_DATA(colors[c]);
+            else LCD_WR_DATA(gx ? gx : gridY[y]);
+        }
+    }
+    LCD_Set_Window(0, 0, MAX_X - 1, MAX_Y - 1);
+}
+
+/**
+ * Persistence mode frame: add all waveforms coming during PERSIST_ACQ_US, then show
+ */
+void drawPersist() {
+    u32 seq = acqCount;
+    u32 t0 = DWT_Get_Current_Tick();
+
+    persistWaves = 0;
+    while (DWT_Elapsed_Tick(t0) < PERSIST_ACQ_US * DWT_IN_MICROSEC) {
+        if (!nextAcquisition(&seq))
+            break;
+        buildGraph1ch();
+        PERSIST_add();
+    }
+    PERSIST_decay();
+    PERSIST_draw();
+}
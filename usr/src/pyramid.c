@@ -0,0 +1,129 @@
+#include <dwt.h>
+#include <graph.h>
+#include "pyramid.h"
+
+/**
+ * Min/max pyramid of a record. Level 0 - min/max of PYR_LEAF samples,
+ * every next level - min/max of 2 nodes below. Levels are stored one after
+ * another, level L starts at 2*PYR_LEAVES - (2*PYR_LEAVES >> L).
+ * Each half of samples buffer gets its pyramid from ADC callbacks when filled,
+ * so any range min/max of the record is ready without scanning the samples.
+ */
+
+PYR_INDEX pyrHalf[2];
+
+uint32_t PyrUpdateTick;
+
+static inline u32 levelStart(u32 level) {
+    return 2 * PYR_LEAVES - (2 * PYR_LEAVES >> level);
+}
+
+/**
+ * Rebuild pyramid of filled half. Called from interrupt.
+ * @param half 0 - first half of samples buffer, 1 - second
+ */
+void PYR_update(u32 half) {
+    u32 t0 = DWT_Get_Current_Tick();
+    PYR_INDEX *pyr = &pyrHalf[half];
+    u32 const *p = (u32 const *) &samplesBuffer[half * PYR_RECORD];
+
+    // leaves, 4 samples per step
+    for (u32 k = 0; k < PYR_LEAVES; k++) {
+        u32 mx = p[0], mn = p[0], d;
+        for (u32 w = 1; w < PYR_LEAF / 4; w++) {
+            u32 v = p[w];
+            d = __UQSUB8(v, mx);
+            mx = __UADD8(mx, d);
+            d = __UQSUB8(mn, v);
+            mn = __USUB8(mn, d);
+        }
+        p += PYR_LEAF / 4;
+
+        // fold 4 lanes to lane 0
+        d = __UQSUB8(mx >> 16, mx);
+        mx = __UADD8(mx, d);
+        d = __UQSUB8(mx >> 8, mx);
+        mx = __UADD8(mx, d);
+        d = __UQSUB8(mn, mn >> 16);
+        mn = __USUB8(mn, d);
+        d = __UQSUB8(mn, mn >> 8);
+        mn = __USUB8(mn, d);
+        pyr->min[k] = (u8) mn;
+        pyr->max[k] = (u8) mx;
+    }
+
+    // parents up to root
+    u32 below = 0;
+    for (u32 level = 1; (PYR_LEAVES >> level) != 0; level++) {
+        u32 at = levelStart(level);
+        for (u32 k = 0; k < (PYR_LEAVES >> level); k++) {
+            u32 c = below + 2 * k;
+            pyr->min[at + k] = pyr->min[c] < pyr->min[c + 1] ? pyr->min[c] : pyr->min[c + 1];
+            pyr->max[at + k] = pyr->max[c] > pyr->max[c + 1] ? pyr->max[c] : pyr->max[c + 1];
+        }
+        below = at;
+    }
+    PyrUpdateTick = DWT_Elapsed_Tick(t0);
+}
+
+/**
+ * Min and max of rec[a..b), a < b, rec - record of pyramid pyr.
+ * Samples up to leaf boundaries, then at most 2 nodes per level.
+ */
+void PYR_minMax(PYR_INDEX const *pyr, u8 const *rec, u32 a, u32 b, u8 *pMin, u8 *pMax) {
+    u8 lo = 255, hi = 0;
+
+    for (; a < b && (a & (PYR_LEAF - 1)); a++) {
+        u8 v = rec[a];
+        if (v < lo) lo = v;
+        if (v > hi) hi = v;
+    }
+    for (; b > a && (b & (PYR_LEAF - 1)); ) {
+        u8 v = rec[--b];
+        if (v < lo) lo = v;
+        if (v > hi) hi = v;
+    }
+
+    u32 l = a >> PYR_LEAF_BITS, r = b >> PYR_LEAF_BITS;  // nodes [l, r)
+    for (u32 level = 0; l < r; level++, l >>= 1, r >>= 1) {
+        u32 at = levelStart(level);
+        if (l & 1) {
+            if (pyr->min[at + l] < lo) lo = pyr->min[at + l];
+            if (pyr->max[at + l] > hi) hi = pyr->max[at + l];
+            l++;
+        }
+        if (r & 1) {
+            r--;
+            if (pyr->min[at + r] < lo) lo = pyr->min[at + r];
+            if (pyr->max[at + r] > hi) hi = pyr->max[at + r];
+        }
+    }
+    *pMin = lo;
+    *pMax = hi;
+}
+
+/**
+ * Peak detect graph of rec[first..count), column j gets
+ * samples [ceil(j*step), ceil((j+1)*step)) - same split as buildGraphStep.
+ * Column narrower than a leaf is a plain scan of its samples.
+ * @param step samples per column, Q16.16
+ * @return number of built columns
+ */
+int PYR_buildGraph(PYR_INDEX const *pyr, u8 const *rec, u32 first, u32 count, u32 step) {
+    u32 pos = 0, i = first, end;
+    int j;
+
+    for (j = 0; j < MAX_X && i < count; j++, i = end) {
+        pos += step;
+        end = first + ((pos + 0xFFFF) >> 16);
+        if (end > count) end = count;
+
+        u8 lo, hi;
+        PYR_minMax(pyr, rec, i, end, &lo, &hi);
+        // table is descending: max code is upper pixel
+        graphMin[j] = vlut[hi];
+        graphMax[j] = vlut[lo];
+        graph[j] = vlut[(lo + hi) >> 1];
+    }
+    return j;
+}
@@ -0,0 +1,146 @@
+#include <_main.h>
+#include <DataBuffer.h>
+#include "trigger.h"
+
+/**
+ * Hardware trigger
+ *
+ * PB2 (COMP1_INP2) - probe signal, must be wired in parallel with PA6 (ADC1_INP3)
+ * DAC1 CH1         - trigger threshold, connected internally to COMP1 inverting input
+ * COMP1 output     - TIM2 TI4, input capture on rising edge
+ * TIM2 CC4 DMA     - copy NDTR of ADC DMA stream to trgLatch ring
+ *
+ * So every crossing stores the ADC buffer write position of the sample that crossed level.
+ */
+
+TIM_HandleTypeDef htim2;
+DMA_HandleTypeDef hdma_tim2_ch4;
+
+// ADC DMA NDTR snapshots. Written by DMA, must be out of DTCM.
+ALIGN_32BYTES(__SECTION_AXIRAM u32 trgLatch[TRG_LATCH_SIZE]);
+
+u8 trgMode = TRG_COMPARATOR;
+u8 trgLevel = 128;     // in ADC codes (8 bit)
+u8 trgHysteresis = 1;  // COMP hysteresis: 0 - none, 1 - low, 2 - medium, 3 - high
+
+
+void TRG_setLevel(u8 level) {
+    trgLevel = level;
+    // 8 bit ADC and 8 bit DAC both referenced to VREF+
+    DAC1->DHR8R1 = level;
+}
+
+void TRG_setHysteresis(u8 hyst) {
+    trgHysteresis = hyst & (u8) 3;
+    COMP1->CFGR = (COMP1->CFGR & ~COMP_CFGRx_HYST) | (trgHysteresis << COMP_CFGRx_HYST_Pos);
+}
+
+/**
+ * DAC1 CH1 -> COMP1 -> TIM2 CH4 -> DMA1 Stream2
+ * HAL COMP/DAC drivers are not in project, so those are set up by registers.
+ */
+void TRG_init() {
+    GPIO_InitTypeDef GPIO_InitStruct = {0};
+    TIM_IC_InitTypeDef sConfigIC = {0};
+
+    for (int i = 0; i < TRG_LATCH_SIZE; i++) trgLatch[i] = 0;  // 0 never read from active circular stream
+    SCB_CleanDCache_by_Addr(trgLatch, sizeof(trgLatch));
+
+    // DAC1 CH1: normal mode, connected to on-chip peripherals only, buffer disabled
+    __HAL_RCC_DAC12_CLK_ENABLE();
+    DAC1->MCR = (DAC1->MCR & ~DAC_MCR_MODE1) | DAC_MCR_MODE1_1 | DAC_MCR_MODE1_0;
+    DAC1->CR |= DAC_CR_EN1;
+    TRG_setLevel(trgLevel);
+
+    // COMP1: INP2 (PB2) vs DAC1_CH1, high speed
+    __HAL_RCC_GPIOB_CLK_ENABLE();
+    GPIO_InitStruct.Pin = GPIO_PIN_2;
+    GPIO_InitStruct.Mode = GPIO_MODE_ANALOG;
+    GPIO_InitStruct.Pull = GPIO_NOPULL;
+    HAL_GPIO_Init(GPIOB, &GPIO_InitStruct);
+
+    __HAL_RCC_COMP12_CLK_ENABLE();
+    COMP1->CFGR = COMP_CFGRx_INPSEL               // INP2
+                  | COMP_CFGRx_INMSEL_2           // 100: DAC1_CH1
+                  | (trgHysteresis << COMP_CFGRx_HYST_Pos)
+                  | COMP_CFGRx_EN;
+
+    // TIM2: free running, CH4 captures COMP1 output
+    __HAL_RCC_TIM2_CLK_ENABLE();
+    htim2.Instance = TIM2;
+    htim2.Init.Prescaler = 0;
+    htim2.Init.CounterMode = TIM_COUNTERMODE_UP;
+    htim2.Init.Period = 0xFFFFFFFF;
+    htim2.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+    htim2.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+    if (HAL_TIM_IC_Init(&htim2) != HAL_OK)
+        Error_Handler();
+
+    sConfigIC.ICPolarity = TIM_INPUTCHANNELPOLARITY_RISING;
+    sConfigIC.ICSelection = TIM_ICSELECTION_DIRECTTI;
+    sConfigIC.ICPrescaler = TIM_ICPSC_DIV1;
+    sConfigIC.ICFilter = 0;
+    if (HAL_TIM_IC_ConfigChannel(&htim2, &sConfigIC, TIM_CHANNEL_4) != HAL_OK)
+        Error_Handler();
+    TIM2->TISEL = (TIM2->TISEL & ~TIM_TISEL_TI4SEL) | TIM_TISEL_TI4SEL_0;  // TI4 <- COMP1_OUT
+
+    // DMA: on CC4 copy ADC DMA NDTR to latch ring
+    hdma_tim2_ch4.Instance = DMA1_Stream2;
+    hdma_tim2_ch4.Init.Request = DMA_REQUEST_TIM2_CH4;
+    hdma_tim2_ch4.Init.Direction = DMA_PERIPH_TO_MEMORY;
+    hdma_tim2_ch4.Init.PeriphInc = DMA_PINC_DISABLE;
+    hdma_tim2_ch4.Init.MemInc = DMA_MINC_ENABLE;
+    hdma_tim2_ch4.Init.PeriphDataAlignment = DMA_PDATAALIGN_WORD;
+    hdma_tim2_ch4.Init.MemDataAlignment = DMA_MDATAALIGN_WORD;
+    hdma_tim2_ch4.Init.Mode = DMA_CIRCULAR;
+    hdma_tim2_ch4.Init.Priority = DMA_PRIORITY_VERY_HIGH;
+    hdma_tim2_ch4.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+    if (HAL_DMA_Init(&hdma_tim2_ch4) != HAL_OK)
+        Error_Handler();
+
+    DMA_Stream_TypeDef *adcStream = (DMA_Stream_TypeDef *) hdma_adc1.Instance;
+    if (HAL_DMA_Start(&hdma_tim2_ch4, (u32) &adcStream->NDTR, (u32) trgLatch, TRG_LATCH_SIZE) != HAL_OK)
+        Error_Handler();
+
+    __HAL_TIM_ENABLE_DMA(&htim2, TIM_DMA_CC4);
+    HAL_TIM_IC_Start(&htim2, TIM_CHANNEL_4);
+}
+
+/**
+ * Looking for the earliest latched comparator trigger inside [start, start + len) of samplesBuffer.
+ * Ring holds NDTR only, so latches are ordered by age: samples written since latch,
+ * one more buffer length each time position goes up walking to older ones.
+ * Range is taken at its last writing, older cycles stop the search.
+ * @return index relative to start. If no latch in range - -1
+ */
+int TRG_findLatched(u32 start, u32 len) {
+    int found = -1;
+
+    SCB_InvalidateDCache_by_Addr(trgLatch, sizeof(trgLatch));
+    // next ring slot to be written by DMA, ADC position read after it - no walked latch is newer
+    u32 head = TRG_LATCH_SIZE - ((DMA_Stream_TypeDef *) hdma_tim2_ch4.Instance)->NDTR;
+    u32 cur = BUF_SIZE - ((DMA_Stream_TypeDef *) hdma_adc1.Instance)->NDTR;
+
+    // age: 0 - last written sample
+    u32 ageEnd = (cur + 2 * BUF_SIZE - 1 - (start + len - 1)) % BUF_SIZE;
+    u32 ageStart = ageEnd + len - 1;
+    u32 wrap = 0, last = 0;
+
+    // from newest to oldest
+    for (u32 n = 1; n <= TRG_LATCH_SIZE; n++) {
+        u32 ndtr = trgLatch[(head + TRG_LATCH_SIZE - n) % TRG_LATCH_SIZE];
+        if (ndtr == 0 || ndtr > BUF_SIZE) continue;  // empty slot
+
+        u32 pos = BUF_SIZE - ndtr;  // ADC write position at crossing
+        u32 age = (cur + 2 * BUF_SIZE - 1 - pos) % BUF_SIZE + wrap;
+        if (age < last) {
+            wrap += BUF_SIZE;
+            age += BUF_SIZE;
+        }
+        last = age;
+
+        if (age > ageStart) break;  // older than range
+        if (age >= ageEnd) found = (int) (pos - start);
+    }
+    return found;
+}
@@ -0,0 +1,84 @@
+#include <lcd_fmc.h>
+#include <dwt.h>
+#include <fft.h>
+#include <graph.h>
+#include <persist.h>
+#include <DataBuffer.h>
+#include "waterfall.h"
+
+/**
+ * Waterfall: one short spectrum per filled half buffer, drawn as one line
+ * of the panel, older lines moved by the ILI9341 hardware scroll.
+ * Panel scrolls along its native 320 line axis, in horizontal screen
+ * that is X: time goes right to left, frequency goes up.
+ * With MV|MY memory access the column address x is written to memory line 319 - x.
+ */
+
+static u16 wfHead;      // memory line of newest row
+static u16 wfSavedSize; // spectrum mode FFT size
+u32 wfRows;
+
+uint32_t WFRowTick;
+
+
+void WF_start() {
+    wfSavedSize = fftSize;
+    FFT_setup(WF_FFT, fftWindow);
+
+    LCD_Clear(BLACK);
+    LCD_Scroll_Area(0, MAX_X, 0);
+    wfHead = 0;
+    LCD_Scroll(wfHead);
+}
+
+void WF_stop() {
+    LCD_Scroll(0);
+    FFT_setup(wfSavedSize, fftWindow);
+}
+
+/**
+ * Spectrum of last filled half as one screen column, low frequency at bottom
+ */
+static void WF_addRow() {
+    u32 t0 = DWT_Get_Current_Tick();
+    u32 bins = WF_FFT / 2;
+
+    FFT_run(firstHalf ? &samplesBuffer[BUF_SIZE / 2] : samplesBuffer, BUF_SIZE / 2);
+
+    // newest row goes to previous memory line, scroll start follows it
+    wfHead = wfHead == 0 ? MAX_X - 1 : wfHead - 1;
+    u16 x = MAX_X - 1 - wfHead;
+    LCD_Set_Window(x, 0, x, MAX_Y - 1);
+    LCD_WR_REG(LCD_WR_RAM_CMD);
+    for (s32 f = MAX_Y - 1; f >= 0; f--) {  // window is filled from top - highest frequency first
+        u32 b = (u32) f * bins / MAX_Y, end = (u32) (f + 1) * bins / MAX_Y;
+        float db = fftDb[b];
+        for (b++; b < end; b++)
+            if (fftDb[b] > db) db = fftDb[b];
+
+        s32 c = (s32) ((db + FFT_RANGE_DB) * 255 / FFT_RANGE_DB);
+        if (c < 0) c = 0;
+        if (c > 255) c = 255;
+        LCD_WR_DATA(persistPalette[c]);
+    }
+    LCD_Scroll(wfHead);
+    wfRows++;
+
+    WFRowTick = DWT_Elapsed_Tick(t0);
+}
+
+/**
+ * Waterfall frame: one row per half buffer coming during WF_ACQ_US
+ */
+void drawWaterfall() {
+    u32 seq = acqCount;
+    u32 t0 = DWT_Get_Current_Tick();
+
+    wfRows = 0;
+    while (DWT_Elapsed_Tick(t0) < WF_ACQ_US * DWT_IN_MICROSEC) {
+        if (!nextAcquisition(&seq))
+            break;
+        WF_addRow();
+    }
+    LCD_Set_Window(0, 0, MAX_X - 1, MAX_Y - 1);
+}
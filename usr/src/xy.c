@@ -0,0 +1,115 @@
+#include <lcd_fmc.h>
+#include <dwt.h>
+#include <adc.h>
+#include <graph.h>
+#include <draw.h>
+#include <DataBuffer.h>
+#include "xy.h"
+
+/**
+ * XY display: ADC1 - horizontal, ADC2 - vertical, sampled simultaneously.
+ * Points of one frame collected in 1 bit per pixel bitmap, only pixels
+ * changed from the previous frame are sent to LCD.
+ */
+
+#define XY_WORDS  (MAX_X / 32)
+
+// current and previous frame, bit set - point lit
+__ALIGNED(4) static u32 xyBits[2][MAX_Y][XY_WORDS];
+static u8 xyCur;
+
+u32 xyPoints;
+uint32_t XYDrawTick;
+
+
+/**
+ * Switch ADC to dual mode, draw the grid once - after that only changes drawn
+ */
+void XY_start() {
+    u32 *p = (u32 *) xyBits;
+    for (u32 i = 0; i < sizeof(xyBits) / 4; i++) p[i] = 0;
+    xyCur = 0;
+
+    ADC_setXY(1);
+    drawFrame();
+}
+
+void XY_stop() {
+    ADC_setXY(0);
+}
+
+/**
+ * Plot all pairs of the last filled half buffer. Pair is half word: low byte X, high byte Y.
+ */
+static void XY_add(u32 (*bits)[XY_WORDS]) {
+    u32 const *p = (u32 const *) (firstHalf ? &samplesBuffer[BUF_SIZE / 2] : samplesBuffer);
+    u32 const *end = p + BUF_SIZE / 2 / 4;
+
+    for (; p < end; p++) {
+        u32 v = *p;  // two pairs
+        u32 x = hlut[v & 0xFF], y = vlut[(v >> 8) & 0xFF];
+        bits[y][x >> 5] |= 1U << (x & 31);
+        x = hlut[(v >> 16) & 0xFF], y = vlut[v >> 24];
+        bits[y][x >> 5] |= 1U << (x & 31);
+    }
+    xyPoints += BUF_SIZE / 2 / 2;
+}
+
+static inline u16 gridColor(u16 x, u16 y) {
+    return gridX[x] ? gridX[x] : gridY[y];
+}
+
+/**
+ * Send pixels that differ between frames. Each run of changed pixels in a row
+ * costs one window setup instead of cursor setup per pixel.
+ */
+static void XY_update(u32 (*cur)[XY_WORDS], u32 (*prev)[XY_WORDS]) {
+    for (u16 y = 0; y < MAX_Y; y++) {
+        for (u16 w = 0; w < XY_WORDS; w++) {
+            u32 diff = cur[y][w] ^ prev[y][w];
+            u32 on = cur[y][w];
+
+            while (diff) {
+                u32 b = __CLZ(__RBIT(diff));                // first changed bit
+                u32 r = ~(diff >> b);
+                u32 n = r ? __CLZ(__RBIT(r)) : 32 - b;      // changed bits in a row
+                u16 x = (u16) (w * 32 + b);
+
+                LCD_Damage(x, y, (u16) (x + n - 1), y);
+                LCD_Set_Window(x, y, (u16) (x + n - 1), y);
+                LCD_WR_REG(LCD_WR_RAM_CMD);
+                for (u32 i = b; i < b + n; i++, x++)
+                    LCD_WR_DATA((on >> i) & 1 ? XY_COLOR : gridColor(x, y));
+
+                diff &= n + b < 32 ? ~0U << (n + b) : 0;
+            }
+        }
+    }
+    LCD_Set_Window(0, 0, MAX_X - 1, MAX_Y - 1);
+}
+
+/**
+ * XY frame: plot all pairs coming during XY_ACQ_US, show difference with previous frame
+ */
+void drawXY() {
+    u32 seq = acqCount;
+    u32 t0 = DWT_Get_Current_Tick();
+    u32 (*cur)[XY_WORDS] = xyBits[xyCur];
+    u32 (*prev)[XY_WORDS] = xyBits[xyCur ^ 1];
+
+    u32 *p = (u32 *) cur;
+    for (u32 i = 0; i < sizeof(xyBits[0]) / 4; i++) p[i] = 0;
+
+    xyPoints = 0;
+    while (DWT_Elapsed_Tick(t0) < XY_ACQ_US * DWT_IN_MICROSEC) {
+        if (!nextAcquisition(&seq))
+            break;
+        XY_add(cur);
+    }
+
+    t0 = DWT_Get_Current_Tick();
+    XY_update(cur, prev);
+    XYDrawTick = DWT_Elapsed_Tick(t0);
+
+    xyCur ^= 1;
+}
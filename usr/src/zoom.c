@@ -0,0 +1,178 @@
+#include <string.h>
+#include <dwt.h>
+#include <graph.h>
+#include <DataBuffer.h>
+#include <events.h>
+#include <pyramid.h>
+#include "zoom.h"
+
+/**
+ * Dual time base: overview of the whole record on top, zoom window below.
+ * Record is copied out of samples buffer when a triggered half comes and
+ * not on hold. Overview is kept while the record is the same, so moving
+ * the window rebuilds the zoom pane only.
+ */
+
+u16 zoomPos = 0;
+u16 zoomLen = MAX_X / 2;
+u8 zoomHold = 0;
+static u8 zoomAction;  // of encoder
+
+__ALIGNED(4) static u8 ovMin[MAX_X];
+__ALIGNED(4) static u8 ovMax[MAX_X];
+__ALIGNED(4) static u8 zmMin[MAX_X];
+__ALIGNED(4) static u8 zmMax[MAX_X];
+static u16 ovCols, zmCols;
+__SECTION_AXIRAM static u8 zoomRecord[ZOOM_RECORD];
+static PYR_INDEX zoomPyr;         // min/max pyramid of zoomRecord
+static u32 zoomSeq = 0xFFFFFFFF;  // acqCount of last checked half
+static u8 zoomEmpty = 1;          // no record yet
+static u8 zoomDirty = 1;          // window moved
+
+uint32_t ZoomBuildTick;
+
+
+/**
+ * Keep window inside record, with room for interpolation taps
+ */
+void zoomSetWindow(int pos, int len) {
+    if (len < 16) len = 16;
+    if (len > ZOOM_RECORD) len = ZOOM_RECORD;
+    if (pos > ZOOM_RECORD - len) pos = ZOOM_RECORD - len;
+    if (pos < 0) pos = 0;
+
+    if (pos != zoomPos || len != zoomLen) {
+        zoomPos = (u16) pos;
+        zoomLen = (u16) len;
+        zoomDirty = 1;
+    }
+}
+
+/**
+ * Move graph columns into half height pane starting at row top
+ */
+static u16 toPane(u8 *mn, u8 *mx, int cols, u8 top) {
+    for (int j = 0; j < cols; j++) {
+        mn[j] = top + (graphMin[j] >> 1);
+        mx[j] = top + (graphMax[j] >> 1);
+    }
+    return (u16) cols;
+}
+
+/**
+ * Columns of record from start: decimated peak detect from pyramid, O(columns * log),
+ * zoom in and averaging - from samples
+ */
+static int buildPane(int start, u32 step) {
+    if (graphMode == GRAPH_PEAK && step >= 0x10000)
+        return PYR_buildGraph(&zoomPyr, zoomRecord, (u32) start, ZOOM_RECORD, step);
+    return buildGraphStep(zoomRecord, start, ZOOM_RECORD, step);
+}
+
+static void buildOverview() {
+    u32 step = ((u32) ZOOM_RECORD << 16) / MAX_X;
+    ovCols = toPane(ovMin, ovMax, buildPane(0, step), 0);
+}
+
+static void buildZoomPane() {
+    u32 step = ((u32) zoomLen << 16) / MAX_X;
+    zmCols = toPane(zmMin, zmMax, buildPane(zoomPos, step), ZOOM_SPLIT);
+}
+
+/**
+ * Encoder action of zoom mode, by button. Stepping through events holds the record,
+ * its event table goes to debug output once.
+ */
+void zoomSelect(u8 action) {
+    u8 hold = action == 2;
+
+    zoomAction = action;
+    if (hold && !zoomHold) EV_export();
+    zoomHold = hold;
+}
+
+/**
+ * Encoder in zoom mode. Action 0 - move window by 1/8 of its length per step,
+ * 1 - window length twice shorter or longer per step, centre kept,
+ * 2 - next or previous event per step
+ */
+void zoomControl(int step) {
+    u8 action = zoomAction;
+
+    if (action == 0) {
+        int move = zoomLen / 8;
+        zoomSetWindow(zoomPos + step * (move ? move : 1), zoomLen);
+    } else if (action == 1) {
+        int len = zoomLen;
+        for (; step > 0 && len > 16; step--) len /= 2;
+        for (; step < 0 && len < ZOOM_RECORD; step++) len *= 2;
+        zoomSetWindow(zoomPos + zoomLen / 2 - len / 2, len);
+    } else {
+        for (; step > 0; step--) zoomStepEvent(1);
+        for (; step < 0; step++) zoomStepEvent(-1);
+    }
+}
+
+/**
+ * Step to next (dir > 0) or previous event and center zoom window on it
+ */
+void zoomStepEvent(int dir) {
+    int n = dir > 0 ? EV_next() : EV_prev();
+    if (n >= 0)
+        zoomSetWindow(evTable[n].pos - zoomLen / 2, zoomLen);
+}
+
+static const u16 evColors[] = {GREEN, GREEN, MAGENTA, RED};
+
+/**
+ * Event ticks at bottom of overview, selected event - full height line in zoom pane
+ */
+static void drawEvents() {
+    for (u16 n = 0; n < evCount; n++) {
+        u16 x = (u16) ((u32) evTable[n].pos * MAX_X / ZOOM_RECORD);
+        u16 top = n == evCurrent ? ZOOM_SPLIT - 12 : ZOOM_SPLIT - 6;
+        LCD_Fill(x, top, x, ZOOM_SPLIT - 2, evColors[evTable[n].type]);
+    }
+
+    if (evCurrent >= 0 && evTable[evCurrent].pos >= zoomPos && evTable[evCurrent].pos < zoomPos + zoomLen) {
+        u16 x = (u16) ((u32) (evTable[evCurrent].pos - zoomPos) * MAX_X / zoomLen);
+        LCD_Fill(x, ZOOM_SPLIT, x, MAX_Y - 1, evColors[evTable[evCurrent].type]);
+    }
+}
+
+void drawZoom() {
+    u32 t0 = DWT_Get_Current_Tick();
+
+    // new triggered record - both panes, same record - zoom pane only if window moved
+    if (!zoomHold && acqCount != zoomSeq) {
+        zoomSeq = acqCount;
+        u8 const *half = firstHalf ? &samplesBuffer[BUF_SIZE / 2] : samplesBuffer;
+        if (triggerStart1ch(half) > 0 || zoomEmpty) {
+            memcpy(zoomRecord, half, ZOOM_RECORD);
+            zoomPyr = pyrHalf[firstHalf];  // built by ADC callback with the half
+            zoomEmpty = 0;
+            buildOverview();
+            EV_search(zoomRecord, ZOOM_RECORD);
+            zoomDirty = 1;
+        }
+    }
+    if (zoomDirty) {
+        buildZoomPane();
+        zoomDirty = 0;
+    }
+    ZoomBuildTick = DWT_Elapsed_Tick(t0);
+
+    // window bounds on overview
+    u16 x0 = (u16) ((u32) zoomPos * MAX_X / ZOOM_RECORD);
+    u16 x1 = (u16) ((u32) (zoomPos + zoomLen) * MAX_X / ZOOM_RECORD);
+    if (x1 > MAX_X - 1) x1 = MAX_X - 1;
+    LCD_Fill(x0, 0, x1, 1, WHITE);
+    LCD_Fill(x0, 0, x0, ZOOM_SPLIT - 2, WHITE);
+    LCD_Fill(x1, 0, x1, ZOOM_SPLIT - 2, WHITE);
+    LCD_Fill(0, ZOOM_SPLIT - 1, MAX_X - 1, ZOOM_SPLIT - 1, GRAY);
+
+    drawEvents();
+    drawSpans(ovMin, ovMax, ovCols, BLUE);
+    drawSpans(zmMin, zmMax, zmCols, BLUE);
+    LCD_Set_Window(0, 0, MAX_X - 1, MAX_Y - 1);
+}